@@ -31,58 +31,44 @@
 #include "backtracking.h"
 #include "graph_operations.h"
 
-PlannerBacktracking::BacktrackResult PlannerBacktracking::backtrack(PlannerSolutionGraph p_graph, int p_parent_node_id, int p_current_node_id, Dictionary p_state, TypedArray<Variant> p_blacklisted_commands) {
+PlannerBacktracking::BacktrackResult PlannerBacktracking::backtrack(PlannerSolutionGraph &p_graph, int p_parent_node_id, int p_current_node_id) {
 	// Mark current node as failed
 	p_graph.set_node_status(p_current_node_id, PlannerNodeStatus::STATUS_FAILED);
 
 	// Remove descendants of the failed node
 	PlannerGraphOperations::remove_descendants(p_graph, p_current_node_id);
 
-	// Find the nearest ancestor that can be retried
+	// Traverse up the tree to find the nearest ancestor with an untried method
 	int new_parent_node_id = p_parent_node_id;
-
-	// Traverse up the tree to find a node that can be retried
 	while (new_parent_node_id >= 0) {
-		Dictionary node = p_graph.get_node(new_parent_node_id);
-		int node_type = node["type"];
-		TypedArray<Callable> available_methods = node["available_methods"];
-
-		// Check if this node has alternative methods
-		bool can_retry = false;
-
-		if (node_type == static_cast<int>(PlannerNodeType::TYPE_TASK) ||
-				node_type == static_cast<int>(PlannerNodeType::TYPE_GOAL) ||
-				node_type == static_cast<int>(PlannerNodeType::TYPE_MULTIGOAL)) {
-			// Check if there are available methods
-			if (available_methods.size() > 0) {
-				can_retry = true;
-			}
-		}
-
-		if (can_retry) {
-			// Found a node with available methods, retry it
+		if (can_retry(p_graph, new_parent_node_id)) {
+			// Drop the previous refinement; refinement resumes after the selected method
+			PlannerGraphOperations::remove_descendants(p_graph, new_parent_node_id);
 			p_graph.set_node_status(new_parent_node_id, PlannerNodeStatus::STATUS_OPEN);
 
 			BacktrackResult result;
-			result.parent_node_id = PlannerGraphOperations::find_predecessor(p_graph, new_parent_node_id);
+			result.parent_node_id = p_graph.get_parent(new_parent_node_id);
 			result.current_node_id = new_parent_node_id;
-			result.graph = p_graph;
-			result.state = p_state;
-			result.blacklisted_commands = p_blacklisted_commands;
 			return result;
-		} else {
-			// No more methods, this node also fails, continue backtracking
-			p_graph.set_node_status(new_parent_node_id, PlannerNodeStatus::STATUS_FAILED);
-			new_parent_node_id = PlannerGraphOperations::find_predecessor(p_graph, new_parent_node_id);
 		}
+
+		// No more methods, this node also fails, continue backtracking
+		p_graph.set_node_status(new_parent_node_id, PlannerNodeStatus::STATUS_FAILED);
+		new_parent_node_id = p_graph.get_parent(new_parent_node_id);
 	}
 
 	// Reached root, return failure
-	BacktrackResult result;
-	result.parent_node_id = -1;
-	result.current_node_id = -1;
-	result.graph = p_graph;
-	result.state = p_state;
-	result.blacklisted_commands = p_blacklisted_commands;
-	return result;
+	return BacktrackResult();
+}
+
+bool PlannerBacktracking::can_retry(const PlannerSolutionGraph &p_graph, int p_node_id) {
+	PlannerNodeType node_type = p_graph.get_node_type(p_node_id);
+	if (node_type != PlannerNodeType::TYPE_TASK &&
+			node_type != PlannerNodeType::TYPE_GOAL &&
+			node_type != PlannerNodeType::TYPE_MULTIGOAL) {
+		return false;
+	}
+	// Nodes that closed without a method (e.g. goal already achieved) have nothing to retry
+	int selected_method_index = p_graph.get_selected_method_index(p_node_id);
+	return selected_method_index >= 0 && selected_method_index + 1 < p_graph.get_available_methods(p_node_id).size();
 }
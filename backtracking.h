@@ -33,21 +33,20 @@
 // SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
 // SPDX-License-Identifier: MIT
 
-#include "core/variant/dictionary.h"
-#include "core/variant/typed_array.h"
 #include "graph_operations.h"
 #include "solution_graph.h"
 
 class PlannerBacktracking {
 public:
 	struct BacktrackResult {
-		int parent_node_id;
-		int current_node_id;
-		PlannerSolutionGraph graph;
-		Dictionary state;
-		TypedArray<Variant> blacklisted_commands;
+		int parent_node_id = -1;
+		int current_node_id = -1;
 	};
 
-	// Backtrack from a failed node
-	static BacktrackResult backtrack(PlannerSolutionGraph p_graph, int p_parent_node_id, int p_current_node_id, Dictionary p_state, TypedArray<Variant> p_blacklisted_commands);
+	// Backtrack from a failed node, editing the graph in place.
+	// The reopened node restores its own state and STN snapshots when revisited.
+	static BacktrackResult backtrack(PlannerSolutionGraph &p_graph, int p_parent_node_id, int p_current_node_id);
+
+	// Whether backtracking would reopen this ancestor rather than fail it too
+	static bool can_retry(const PlannerSolutionGraph &p_graph, int p_node_id);
 };
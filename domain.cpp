@@ -40,6 +40,10 @@ void PlannerDomain::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("add_unigoal_methods", "task_name", "methods"), &PlannerDomain::add_unigoal_methods);
 	ClassDB::bind_method(D_METHOD("add_task_methods", "task_name", "methods"), &PlannerDomain::add_task_methods);
 	ClassDB::bind_method(D_METHOD("add_actions", "actions"), &PlannerDomain::add_actions);
+	ClassDB::bind_method(D_METHOD("set_method_pure", "method", "pure"), &PlannerDomain::set_method_pure);
+	ClassDB::bind_method(D_METHOD("is_method_pure", "method"), &PlannerDomain::is_method_pure);
+	ClassDB::bind_method(D_METHOD("compile"), &PlannerDomain::compile);
+	ClassDB::bind_method(D_METHOD("is_compiled"), &PlannerDomain::is_compiled);
 
 	ClassDB::bind_static_method("PlannerDomain", D_METHOD("method_verify_goal", "state", "method", "state_var", "arguments", "desired_values", "depth", "verbose"), &PlannerDomain::method_verify_goal);
 }
@@ -88,7 +92,23 @@ PlannerDomain::PlannerDomain() {
 	multigoal_method_list.push_back(callable_mp_static(&PlannerMultigoal::method_split_multigoal));
 }
 
+Ref<PlannerDomain> PlannerDomain::create_snapshot() const {
+	Ref<PlannerDomain> snapshot;
+	snapshot.instantiate();
+	snapshot->action_dictionary = action_dictionary.duplicate(true);
+	snapshot->task_method_dictionary = task_method_dictionary.duplicate(true);
+	snapshot->unigoal_method_dictionary = unigoal_method_dictionary.duplicate(true);
+	snapshot->multigoal_method_list = multigoal_method_list.duplicate(true);
+	snapshot->pure_methods = pure_methods.duplicate(true);
+	snapshot->native_calls = native_calls;
+	if (compiled) {
+		snapshot->compile();
+	}
+	return snapshot;
+}
+
 void PlannerDomain::add_multigoal_methods(TypedArray<Callable> p_methods) {
+	ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
 	for (int i = 0; i < p_methods.size(); ++i) {
 		Callable m = p_methods[i];
 		if (m.is_null()) {
@@ -101,6 +121,7 @@ void PlannerDomain::add_multigoal_methods(TypedArray<Callable> p_methods) {
 }
 
 void PlannerDomain::add_unigoal_methods(String p_task_name, TypedArray<Callable> p_methods) {
+	ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
 	if (!unigoal_method_dictionary.has(p_task_name)) {
 		unigoal_method_dictionary[p_task_name] = p_methods;
 	} else {
@@ -119,6 +140,7 @@ void PlannerDomain::add_unigoal_methods(String p_task_name, TypedArray<Callable>
 }
 
 void PlannerDomain::add_task_methods(String p_task_name, TypedArray<Callable> p_methods) {
+	ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
 	if (task_method_dictionary.has(p_task_name)) {
 		TypedArray<Callable> existing_methods = task_method_dictionary[p_task_name];
 		for (int i = 0; i < p_methods.size(); ++i) {
@@ -137,6 +159,7 @@ void PlannerDomain::add_task_methods(String p_task_name, TypedArray<Callable> p_
 }
 
 void PlannerDomain::add_actions(TypedArray<Callable> p_actions) {
+	ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
 	for (int64_t i = 0; i < p_actions.size(); ++i) {
 		Callable action = p_actions[i];
 		if (action.is_null()) {
@@ -147,6 +170,56 @@ void PlannerDomain::add_actions(TypedArray<Callable> p_actions) {
 	}
 }
 
+void PlannerDomain::set_method_pure(const Callable &p_method, bool p_pure) {
+	ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
+	if (p_pure) {
+		pure_methods[p_method] = true;
+	} else {
+		pure_methods.erase(p_method);
+	}
+}
+
+bool PlannerDomain::is_method_pure(const Callable &p_method) const {
+	return pure_methods.has(p_method);
+}
+
+void PlannerDomain::_add_symbol(const Variant &p_name, PlannerNodeType p_type, const TypedArray<Callable> &p_methods, const Callable &p_action) {
+	// A name registered as several kinds keeps the first one, matching the planner's lookup order
+	if (symbol_ids.has(p_name)) {
+		return;
+	}
+	Symbol symbol;
+	symbol.type = p_type;
+	symbol.methods = p_methods;
+	symbol.action = p_action;
+	symbol_ids.insert(p_name, symbols.size());
+	symbols.push_back(symbol);
+}
+
+void PlannerDomain::compile() {
+	if (compiled) {
+		return;
+	}
+	Array action_names = action_dictionary.keys();
+	for (int i = 0; i < action_names.size(); i++) {
+		_add_symbol(action_names[i], PlannerNodeType::TYPE_ACTION, TypedArray<Callable>(), action_dictionary[action_names[i]]);
+	}
+	Array task_names = task_method_dictionary.keys();
+	for (int i = 0; i < task_names.size(); i++) {
+		_add_symbol(task_names[i], PlannerNodeType::TYPE_TASK, task_method_dictionary[task_names[i]], Callable());
+	}
+	Array goal_names = unigoal_method_dictionary.keys();
+	for (int i = 0; i < goal_names.size(); i++) {
+		_add_symbol(goal_names[i], PlannerNodeType::TYPE_GOAL, unigoal_method_dictionary[goal_names[i]], Callable());
+	}
+	compiled = true;
+}
+
+int PlannerDomain::find_symbol(const Variant &p_name) const {
+	const int *id = symbol_ids.getptr(p_name);
+	return id ? *id : -1;
+}
+
 PlannerTaskMetadata::PlannerTaskMetadata() {
 	// Generate initial ID
 	Error err = CryptoCore::generate_uuidv7(task_id);
@@ -38,8 +38,18 @@
 
 #include "core/io/resource.h"
 #include "core/object/object.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
 #include "core/variant/typed_array.h"
 #include "planner_time_range.h"
+#include "solution_graph.h"
+
+#include <type_traits>
+#include <utility>
+
+// Registers a C++ function both as a Callable and as a native entry point, e.g.
+// domain->add_native_action(PLANNER_NATIVE(&move_block));
+#define PLANNER_NATIVE(m_function) callable_mp_static(m_function), m_function
 
 class PlannerTaskMetadata : public Resource {
 	GDCLASS(PlannerTaskMetadata, Resource);
@@ -89,11 +99,56 @@ class PlannerDomain : public Resource {
 	friend PlannerPlan;
 
 public:
+	// Typed C++ action or method. The planner calls it with the state and the
+	// arguments of the todo item directly, without building an argument Array
+	// for Callable::callv.
+	struct NativeCall {
+		Variant (*invoke)(void (*p_function)(), const Dictionary &p_state, const Array &p_item) = nullptr;
+		void (*function)() = nullptr;
+
+		// p_item is the todo item; its first element is the name and is skipped
+		Variant call(const Dictionary &p_state, const Array &p_item) const { return invoke(function, p_state, p_item); }
+	};
+
+	// Entry of the compiled symbol table: what a node named after an action, task
+	// or unigoal is typed as, and the methods or action it is created with
+	struct Symbol {
+		PlannerNodeType type = PlannerNodeType::TYPE_ROOT;
+		TypedArray<Callable> methods;
+		Callable action;
+	};
+
 	Dictionary action_dictionary; // Public for testing
 private:
 	Dictionary task_method_dictionary;
 	Dictionary unigoal_method_dictionary;
 	TypedArray<Callable> multigoal_method_list;
+	Dictionary pure_methods; // Task methods whose results the planner may reuse, Callable -> true
+	HashMap<Callable, NativeCall, HashableHasher<Callable>> native_calls;
+
+	// Filled by compile(); the domain can no longer be edited afterwards
+	bool compiled = false;
+	HashMap<Variant, int, VariantHasher, StringLikeVariantComparator> symbol_ids;
+	LocalVector<Symbol> symbols;
+	void _add_symbol(const Variant &p_name, PlannerNodeType p_type, const TypedArray<Callable> &p_methods, const Callable &p_action);
+
+	template <typename S, typename... P, size_t... I>
+	static Variant _invoke_native(void (*p_function)(), const Dictionary &p_state, const Array &p_item, std::index_sequence<I...>) {
+		ERR_FAIL_COND_V_MSG(p_item.size() != int(sizeof...(P)) + 1, Variant(), vformat("Native planner callable expects %d arguments, got %d.", int(sizeof...(P)), p_item.size() - 1));
+		Variant (*function)(S, P...) = reinterpret_cast<Variant (*)(S, P...)>(p_function);
+		return function(p_state, p_item[I + 1]...);
+	}
+
+	template <typename S, typename... P>
+	static NativeCall _make_native_call(Variant (*p_function)(S, P...)) {
+		static_assert(std::is_same_v<std::decay_t<S>, Dictionary>, "Native planner callables take the state Dictionary first.");
+		NativeCall native_call;
+		native_call.invoke = [](void (*p_native)(), const Dictionary &p_state, const Array &p_item) {
+			return _invoke_native<S, P...>(p_native, p_state, p_item, std::index_sequence_for<P...>{});
+		};
+		native_call.function = reinterpret_cast<void (*)()>(p_function);
+		return native_call;
+	}
 
 public:
 	PlannerDomain();
@@ -103,6 +158,51 @@ public:
 	void add_task_methods(String p_task_name, TypedArray<Callable> p_methods);
 	void add_unigoal_methods(String p_task_name, TypedArray<Callable> p_methods);
 	void add_multigoal_methods(TypedArray<Callable> p_methods);
+	void set_method_pure(const Callable &p_method, bool p_pure);
+	bool is_method_pure(const Callable &p_method) const;
+
+	// Native registration for C++ domains, see PLANNER_NATIVE. p_callable must wrap
+	// p_function; it names the action or method and is used wherever a Callable is needed.
+	template <typename S, typename... P>
+	void add_native_action(const Callable &p_callable, Variant (*p_function)(S, P...)) {
+		ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
+		TypedArray<Callable> actions;
+		actions.push_back(p_callable);
+		add_actions(actions);
+		native_calls.insert(p_callable, _make_native_call(p_function));
+	}
+	template <typename S, typename... P>
+	void add_native_task_method(const String &p_task_name, const Callable &p_callable, Variant (*p_function)(S, P...)) {
+		ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
+		TypedArray<Callable> methods;
+		methods.push_back(p_callable);
+		add_task_methods(p_task_name, methods);
+		native_calls.insert(p_callable, _make_native_call(p_function));
+	}
+	template <typename S, typename... P>
+	void add_native_unigoal_method(const String &p_goal_name, const Callable &p_callable, Variant (*p_function)(S, P...)) {
+		ERR_FAIL_COND_MSG(compiled, "Cannot edit a compiled planner domain.");
+		TypedArray<Callable> methods;
+		methods.push_back(p_callable);
+		add_unigoal_methods(p_goal_name, methods);
+		native_calls.insert(p_callable, _make_native_call(p_function));
+	}
+	_FORCE_INLINE_ const NativeCall *get_native_call(const Callable &p_callable) const {
+		return native_calls.is_empty() ? nullptr : native_calls.getptr(p_callable);
+	}
+
+	// Interns every action, task and unigoal name so that planning types a node with
+	// one lookup. The domain is frozen afterwards.
+	void compile();
+	bool is_compiled() const { return compiled; }
+	// Id of the symbol named p_name, or -1. Only valid once compiled
+	int find_symbol(const Variant &p_name) const;
+	const Symbol &get_symbol(int p_id) const { return symbols[p_id]; }
+	const TypedArray<Callable> &get_multigoal_methods() const { return multigoal_method_list; }
+
+	// Deep copy of the action and method tables, safe to read from a worker thread
+	// while this domain keeps being edited
+	Ref<PlannerDomain> create_snapshot() const;
 
 public:
 	static Variant method_verify_goal(Dictionary p_state, String p_method, String p_state_var, String p_arguments, Variant p_desired_values, int p_depth, int verbose);
@@ -84,7 +84,7 @@ PlannerNodeType PlannerGraphOperations::get_node_type(Variant p_node_info, Dicti
 }
 
 int PlannerGraphOperations::add_nodes_and_edges(PlannerSolutionGraph &p_graph, int p_parent_node_id, Array p_children_node_info_list, Dictionary p_action_dict, Dictionary p_task_dict, Dictionary p_unigoal_dict, TypedArray<Callable> p_multigoal_methods) {
-	int current_id = p_graph.next_node_id - 1;
+	int current_id = p_graph.get_next_node_id() - 1;
 
 	for (int i = 0; i < p_children_node_info_list.size(); i++) {
 		Variant child_info = p_children_node_info_list[i];
@@ -139,33 +139,69 @@ int PlannerGraphOperations::add_nodes_and_edges(PlannerSolutionGraph &p_graph, i
 		current_id = child_id;
 	}
 
+	return add_verification_node(p_graph, p_parent_node_id, current_id);
+}
+
+int PlannerGraphOperations::add_nodes_and_edges(PlannerSolutionGraph &p_graph, int p_parent_node_id, const Array &p_children_node_info_list, const PlannerDomain &p_domain) {
+	int current_id = p_graph.get_next_node_id() - 1;
+	const TypedArray<Callable> no_methods;
+
+	for (int i = 0; i < p_children_node_info_list.size(); i++) {
+		const Variant &child_info = p_children_node_info_list[i];
+
+		Variant actual_item = child_info;
+		if (child_info.get_type() == Variant::DICTIONARY) {
+			Dictionary dict = child_info;
+			if (dict.has("item")) {
+				actual_item = dict["item"];
+			}
+		}
+
+		PlannerNodeType node_type = PlannerNodeType::TYPE_ROOT;
+		const TypedArray<Callable> *available_methods = &no_methods;
+		Callable action;
+		if (actual_item.get_type() == Variant::ARRAY) {
+			Array arr = actual_item;
+			int symbol_id = arr.is_empty() ? -1 : p_domain.find_symbol(arr[0]);
+			if (symbol_id >= 0) {
+				const PlannerDomain::Symbol &symbol = p_domain.get_symbol(symbol_id);
+				node_type = symbol.type;
+				available_methods = &symbol.methods;
+				action = symbol.action;
+			}
+		} else if (PlannerMultigoal::is_multigoal_dict(actual_item)) {
+			node_type = PlannerNodeType::TYPE_MULTIGOAL;
+			available_methods = &p_domain.get_multigoal_methods();
+		}
+
+		int child_id = p_graph.create_node(node_type, child_info, *available_methods, action);
+		p_graph.add_successor(p_parent_node_id, child_id);
+		current_id = child_id;
+	}
+
+	return add_verification_node(p_graph, p_parent_node_id, current_id);
+}
+
+int PlannerGraphOperations::add_verification_node(PlannerSolutionGraph &p_graph, int p_parent_node_id, int p_last_node_id) {
 	// Add verification nodes for Goals and MultiGoals if verify_goals is enabled
-	Dictionary parent_node = p_graph.get_node(p_parent_node_id);
-	int parent_type = parent_node["type"];
+	PlannerNodeType parent_type = p_graph.get_node_type(p_parent_node_id);
 
-	if (parent_type == static_cast<int>(PlannerNodeType::TYPE_GOAL)) {
+	if (parent_type == PlannerNodeType::TYPE_GOAL) {
 		int verify_id = p_graph.create_node(PlannerNodeType::TYPE_VERIFY_GOAL, Variant("VerifyGoal"), TypedArray<Callable>(), Callable());
 		p_graph.add_successor(p_parent_node_id, verify_id);
-		current_id = verify_id;
-	} else if (parent_type == static_cast<int>(PlannerNodeType::TYPE_MULTIGOAL)) {
+		return verify_id;
+	} else if (parent_type == PlannerNodeType::TYPE_MULTIGOAL) {
 		int verify_id = p_graph.create_node(PlannerNodeType::TYPE_VERIFY_MULTIGOAL, Variant("VerifyMultiGoal"), TypedArray<Callable>(), Callable());
 		p_graph.add_successor(p_parent_node_id, verify_id);
-		current_id = verify_id;
+		return verify_id;
 	}
 
-	return current_id;
+	return p_last_node_id;
 }
 
 Variant PlannerGraphOperations::find_open_node(PlannerSolutionGraph &p_graph, int p_parent_node_id) {
-	Dictionary parent_node = p_graph.get_node(p_parent_node_id);
-	TypedArray<int> successors = parent_node["successors"];
-
-	for (int i = 0; i < successors.size(); i++) {
-		int node_id = successors[i];
-		Dictionary node = p_graph.get_node(node_id);
-		int status = node["status"];
-
-		if (status == static_cast<int>(PlannerNodeStatus::STATUS_OPEN)) {
+	for (int node_id = p_graph.get_first_successor(p_parent_node_id); node_id != PlannerSolutionGraph::NO_NODE; node_id = p_graph.get_next_sibling(node_id)) {
+		if (p_graph.get_node_status(node_id) == PlannerNodeStatus::STATUS_OPEN) {
 			return node_id;
 		}
 	}
@@ -174,82 +210,58 @@ Variant PlannerGraphOperations::find_open_node(PlannerSolutionGraph &p_graph, in
 }
 
 int PlannerGraphOperations::find_predecessor(PlannerSolutionGraph &p_graph, int p_node_id) {
-	Array keys = p_graph.graph.keys();
-
-	for (int i = 0; i < keys.size(); i++) {
-		int parent_id = keys[i];
-		Dictionary parent_node = p_graph.get_node(parent_id);
-		TypedArray<int> successors = parent_node["successors"];
-
-		if (successors.has(p_node_id)) {
-			return parent_id;
-		}
+	if (!p_graph.has_node(p_node_id)) {
+		return -1;
 	}
-
-	return -1; // No predecessor found
+	return p_graph.get_parent(p_node_id); // -1 for the root
 }
 
 void PlannerGraphOperations::remove_descendants(PlannerSolutionGraph &p_graph, int p_node_id) {
-	TypedArray<int> to_remove;
-	TypedArray<int> visited;
-
-	// Start from the node's successors
-	Dictionary node = p_graph.get_node(p_node_id);
-	TypedArray<int> successors = node["successors"];
-
-	do_get_descendants(p_graph, successors, visited, to_remove);
+	LocalVector<int> to_remove;
+	do_get_descendants(p_graph, p_node_id, to_remove);
 
 	// Remove nodes from graph
-	Dictionary &graph_dict = p_graph.get_graph();
-	for (int i = 0; i < to_remove.size(); i++) {
-		int node_id_to_remove = to_remove[i];
-		if (node_id_to_remove != p_node_id) { // Don't remove the node itself
-			graph_dict.erase(node_id_to_remove);
-		}
+	for (const int &node_id_to_remove : to_remove) {
+		p_graph.remove_node(node_id_to_remove);
 	}
 
 	// Clear successors of the node
-	successors.clear();
-	node["successors"] = successors;
-	p_graph.update_node(p_node_id, node);
+	p_graph.clear_successors(p_node_id);
 }
 
-void PlannerGraphOperations::do_get_descendants(PlannerSolutionGraph &p_graph, TypedArray<int> p_current_nodes, TypedArray<int> &p_visited, TypedArray<int> &p_result) {
-	for (int i = 0; i < p_current_nodes.size(); i++) {
-		int node_id = p_current_nodes[i];
-
-		if (p_visited.has(node_id)) {
-			continue;
-		}
-
-		p_visited.push_back(node_id);
-		p_result.push_back(node_id);
+void PlannerGraphOperations::do_get_descendants(PlannerSolutionGraph &p_graph, int p_node_id, LocalVector<int> &r_result) {
+	// Explicit stack instead of recursion so deep refinements cannot overflow the call stack
+	LocalVector<int> stack;
+	for (int child_id = p_graph.get_first_successor(p_node_id); child_id != PlannerSolutionGraph::NO_NODE; child_id = p_graph.get_next_sibling(child_id)) {
+		stack.push_back(child_id);
+	}
 
-		Dictionary node = p_graph.get_node(node_id);
-		TypedArray<int> successors = node["successors"];
+	while (!stack.is_empty()) {
+		int node_id = stack[stack.size() - 1];
+		stack.remove_at(stack.size() - 1);
+		r_result.push_back(node_id);
 
-		if (successors.size() > 0) {
-			do_get_descendants(p_graph, successors, p_visited, p_result);
+		for (int child_id = p_graph.get_first_successor(node_id); child_id != PlannerSolutionGraph::NO_NODE; child_id = p_graph.get_next_sibling(child_id)) {
+			stack.push_back(child_id);
 		}
 	}
 }
 
 Array PlannerGraphOperations::extract_solution_plan(PlannerSolutionGraph &p_graph) {
 	Array plan;
-	Array to_visit;
+	LocalVector<int> to_visit;
 	to_visit.push_back(0); // Start from root
 
 	while (!to_visit.is_empty()) {
-		int node_id = to_visit.pop_back();
-		Dictionary node = p_graph.get_node(node_id);
+		int node_id = to_visit[to_visit.size() - 1];
+		to_visit.remove_at(to_visit.size() - 1);
 
-		int node_type = node["type"];
-		int node_status = node["status"];
+		PlannerNodeType node_type = p_graph.get_node_type(node_id);
+		PlannerNodeStatus node_status = p_graph.get_node_status(node_id);
 
 		// Only extract actions that are closed (successful)
-		if (node_type == static_cast<int>(PlannerNodeType::TYPE_ACTION) &&
-				node_status == static_cast<int>(PlannerNodeStatus::STATUS_CLOSED)) {
-			Variant info = node["info"];
+		if (node_type == PlannerNodeType::TYPE_ACTION && node_status == PlannerNodeStatus::STATUS_CLOSED) {
+			Variant info = p_graph.get_node_info(node_id);
 			// Unwrap if dictionary-wrapped (has constraints)
 			if (info.get_type() == Variant::DICTIONARY) {
 				Dictionary dict = info;
@@ -261,11 +273,14 @@ Array PlannerGraphOperations::extract_solution_plan(PlannerSolutionGraph &p_grap
 		}
 
 		// Only visit successors of closed nodes (skip failed branches)
-		if (node_status == static_cast<int>(PlannerNodeStatus::STATUS_CLOSED)) {
-			TypedArray<int> successors = node["successors"];
+		if (node_status == PlannerNodeStatus::STATUS_CLOSED) {
 			// Add successors in reverse order to maintain DFS order
-			for (int i = successors.size() - 1; i >= 0; i--) {
-				to_visit.push_back(successors[i]);
+			uint32_t first_pending = to_visit.size();
+			for (int child_id = p_graph.get_first_successor(node_id); child_id != PlannerSolutionGraph::NO_NODE; child_id = p_graph.get_next_sibling(child_id)) {
+				to_visit.push_back(child_id);
+			}
+			for (uint32_t i = first_pending, j = to_visit.size(); i + 1 < j; i++, j--) {
+				SWAP(to_visit[i], to_visit[j - 1]);
 			}
 		}
 	}
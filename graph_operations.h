@@ -33,6 +33,7 @@
 // SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
 // SPDX-License-Identifier: MIT
 
+#include "core/templates/local_vector.h"
 #include "core/variant/variant.h"
 #include "domain.h"
 #include "multigoal.h"
@@ -45,11 +46,13 @@ public:
 
 	// Add nodes and edges to solution graph
 	static int add_nodes_and_edges(PlannerSolutionGraph &p_graph, int p_parent_node_id, Array p_children_node_info_list, Dictionary p_action_dict, Dictionary p_task_dict, Dictionary p_unigoal_dict, TypedArray<Callable> p_multigoal_methods);
+	// Same, typing each node with one lookup in a compiled domain's symbol table
+	static int add_nodes_and_edges(PlannerSolutionGraph &p_graph, int p_parent_node_id, const Array &p_children_node_info_list, const PlannerDomain &p_domain);
 
 	// Find first open node in successors of parent
 	static Variant find_open_node(PlannerSolutionGraph &p_graph, int p_parent_node_id);
 
-	// Find predecessor of a node
+	// Find predecessor of a node (O(1) parent lookup)
 	static int find_predecessor(PlannerSolutionGraph &p_graph, int p_node_id);
 
 	// Remove descendants of a node
@@ -59,5 +62,6 @@ public:
 	static Array extract_solution_plan(PlannerSolutionGraph &p_graph);
 
 private:
-	static void do_get_descendants(PlannerSolutionGraph &p_graph, TypedArray<int> p_current_nodes, TypedArray<int> &p_visited, TypedArray<int> &p_result);
+	static int add_verification_node(PlannerSolutionGraph &p_graph, int p_parent_node_id, int p_last_node_id);
+	static void do_get_descendants(PlannerSolutionGraph &p_graph, int p_node_id, LocalVector<int> &r_result);
 };
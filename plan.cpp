@@ -43,6 +43,8 @@
 #include "domain.h"
 #include "graph_operations.h"
 #include "multigoal.h"
+#include "planner_state_diff.h"
+#include "planner_state_hash.h"
 #include "stn_constraints.h"
 
 int PlannerPlan::get_verbose() const {
@@ -61,6 +63,12 @@ Ref<PlannerDomain> PlannerPlan::get_current_domain() const {
 	return current_domain;
 }
 
+void PlannerPlan::set_current_domain(Ref<PlannerDomain> p_current_domain) {
+	current_domain = p_current_domain;
+	// Cached plans were found with the old domain's methods
+	plan_cache.clear();
+}
+
 void PlannerPlan::set_domains(TypedArray<PlannerDomain> p_domain) {
 	domains = p_domain;
 }
@@ -77,69 +85,107 @@ Variant PlannerPlan::find_plan(Dictionary p_state, Array p_todo_list) {
 		}
 	}
 
-	// Initialize solution graph
-	solution_graph = PlannerSolutionGraph();
-	blacklisted_commands.clear();
-
-	// Initialize STN solver (optional, but keep for consistency)
-	stn.clear();
-	stn.add_time_point("origin");
-
-	// Initialize time range if not already set
-	if (time_range.get_start_time() == 0) {
-		time_range.set_start_time(PlannerTimeRange::now_microseconds());
+	uint64_t cache_key = 0;
+	bool use_plan_cache = plan_cache_size > 0 && current_domain.is_valid();
+	if (use_plan_cache) {
+		cache_key = _plan_cache_key(p_state, p_todo_list);
+		const CachedPlan *cached_plan = plan_cache.getptr(cache_key);
+		if (cached_plan && cached_plan->todo_list == p_todo_list && cached_plan->state == p_state) {
+			if (verbose >= 1) {
+				print_line("Plan cache hit, returning the cached plan");
+			}
+			plan_cache_hit_count++;
+			solution_graph = PlannerSolutionGraph();
+			last_plan_status = PLAN_STATUS_SUCCEEDED;
+			last_expansion_count = 0;
+			last_nogood_hit_count = 0;
+			last_nogood_miss_count = 0;
+			return cached_plan->plan.duplicate(true);
+		}
+		plan_cache_miss_count++;
 	}
 
-	// Anchor origin to current absolute time
-	PlannerSTNConstraints::anchor_to_origin(stn, "origin", time_range.get_start_time());
+	PlanningCursor cursor;
+	_begin_planning(p_state, p_todo_list, cursor);
+	_run_planning_steps(cursor, 0, 0);
+	Variant plan = _finish_plan(cursor.state);
+
+	// Temporal plans are anchored to the time they were found, so they are not cached.
+	// The caller keeps its dictionaries, so the entry stores its own copies.
+	if (use_plan_cache && plan.get_type() == Variant::ARRAY && stn.get_time_point_count() <= 1) {
+		CachedPlan cached_plan;
+		cached_plan.state = p_state.duplicate(true);
+		cached_plan.todo_list = p_todo_list.duplicate(true);
+		cached_plan.plan = Array(plan).duplicate(true);
+		plan_cache.insert(cache_key, cached_plan);
+	}
+	return plan;
+}
 
-	// Add initial tasks to the solution graph
-	int parent_node_id = 0; // Root node
-	PlannerGraphOperations::add_nodes_and_edges(
+int PlannerPlan::_add_child_nodes(int p_parent_node_id, const Array &p_items) {
+	if (current_domain->is_compiled()) {
+		return PlannerGraphOperations::add_nodes_and_edges(solution_graph, p_parent_node_id, p_items, *current_domain.ptr());
+	}
+	return PlannerGraphOperations::add_nodes_and_edges(
 			solution_graph,
-			parent_node_id,
-			p_todo_list,
+			p_parent_node_id,
+			p_items,
 			current_domain->action_dictionary,
 			current_domain->task_method_dictionary,
 			current_domain->unigoal_method_dictionary,
 			current_domain->multigoal_method_list);
+}
 
-	// Start planning loop
-	Dictionary final_state = _planning_loop_recursive(parent_node_id, p_state, 0);
+Variant PlannerPlan::_call_with_item(const Callable &p_callable, const Dictionary &p_state, const Array &p_item) const {
+	const PlannerDomain::NativeCall *native_call = current_domain->get_native_call(p_callable);
+	if (native_call) {
+		return native_call->call(p_state, p_item);
+	}
+	Array args;
+	args.push_back(p_state);
+	args.append_array(p_item.slice(1));
+	return p_callable.callv(args);
+}
 
+uint64_t PlannerPlan::_plan_cache_key(const Dictionary &p_state, const Array &p_todo_list) const {
+	// Domain Callables read the state Dictionary directly, so the planner cannot see which
+	// variables a search depended on; the key covers the whole state instead. The blacklist
+	// starts empty on every call and so is not part of it.
+	uint64_t key = PlannerStateHash::combine(PlannerStateHash::hash_state(p_state), p_todo_list.hash());
+	key = PlannerStateHash::combine(key, verify_goals ? 1 : 0);
+	key = PlannerStateHash::combine(key, max_depth);
+	key = PlannerStateHash::combine(key, max_expansions);
+	return PlannerStateHash::combine(key, time_budget_usec);
+}
+
+Variant PlannerPlan::_finish_plan(const Dictionary &p_final_state) {
 	// Check if planning succeeded (if we got back to root with a valid state)
 	// Planning succeeds if all nodes are closed and we're back at root
-	Dictionary root_node = solution_graph.get_node(0);
-
-	// Check if all nodes are closed (planning succeeded)
 	bool planning_succeeded = true;
-	Dictionary graph = solution_graph.get_graph();
-	Array graph_keys = graph.keys();
 	Array failed_nodes;
 	Array open_nodes;
 
-	for (int i = 0; i < graph_keys.size(); i++) {
-		int node_id = graph_keys[i];
-		if (node_id == 0) {
-			continue; // Skip root
+	for (int node_id = 1; node_id < solution_graph.get_next_node_id(); node_id++) {
+		if (!solution_graph.has_node(node_id)) {
+			continue;
 		}
-		Dictionary node = graph[node_id];
-		int status = node["status"];
+		PlannerNodeStatus status = solution_graph.get_node_status(node_id);
 		// Planning fails if any node is open or failed
-		if (status == static_cast<int>(PlannerNodeStatus::STATUS_OPEN)) {
+		if (status == PlannerNodeStatus::STATUS_OPEN) {
 			planning_succeeded = false;
 			open_nodes.push_back(node_id);
-		} else if (status == static_cast<int>(PlannerNodeStatus::STATUS_FAILED)) {
+		} else if (status == PlannerNodeStatus::STATUS_FAILED) {
 			planning_succeeded = false;
 			failed_nodes.push_back(node_id);
 		}
 	}
 
-	if (planning_succeeded && !final_state.is_empty()) {
+	if (planning_succeeded && !p_final_state.is_empty()) {
+		// A budget may run out on the step that would have reported completion
+		last_plan_status = PLAN_STATUS_SUCCEEDED;
+
 		// Mark root node as CLOSED when planning succeeds so extract_solution_plan can traverse from it
-		Dictionary root_node = solution_graph.get_node(0);
-		root_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-		solution_graph.update_node(0, root_node);
+		solution_graph.set_node_status(0, PlannerNodeStatus::STATUS_CLOSED);
 
 		// Extract the plan from the graph
 		Array plan = PlannerGraphOperations::extract_solution_plan(solution_graph);
@@ -150,21 +196,25 @@ Variant PlannerPlan::find_plan(Dictionary p_state, Array p_todo_list) {
 
 		return plan;
 	} else {
+		if (last_plan_status == PLAN_STATUS_SUCCEEDED) {
+			last_plan_status = PLAN_STATUS_FAILED;
+		}
 		if (verbose >= 1) {
 			print_line("result = false (planning failed)");
 			if (verbose >= 2 || !failed_nodes.is_empty() || !open_nodes.is_empty()) {
 				// Print solution graph for debugging
 				print_line("Solution graph structure:");
-				for (int i = 0; i < graph_keys.size(); i++) {
-					int node_id = graph_keys[i];
-					Dictionary node = graph[node_id];
-					int node_type = node["type"];
-					int node_status = node["status"];
-					Variant node_info = node["info"];
-					TypedArray<int> successors = node["successors"];
+				for (int node_id = 0; node_id < solution_graph.get_next_node_id(); node_id++) {
+					if (!solution_graph.has_node(node_id)) {
+						continue;
+					}
+					PlannerNodeType node_type = solution_graph.get_node_type(node_id);
+					PlannerNodeStatus node_status = solution_graph.get_node_status(node_id);
+					const Variant &node_info = solution_graph.get_node_info(node_id);
+					TypedArray<int> successors = solution_graph.get_successors(node_id);
 
 					String type_str;
-					switch (static_cast<PlannerNodeType>(node_type)) {
+					switch (node_type) {
 						case PlannerNodeType::TYPE_ROOT:
 							type_str = "ROOT";
 							break;
@@ -192,7 +242,7 @@ Variant PlannerPlan::find_plan(Dictionary p_state, Array p_todo_list) {
 					}
 
 					String status_str;
-					switch (static_cast<PlannerNodeStatus>(node_status)) {
+					switch (node_status) {
 						case PlannerNodeStatus::STATUS_OPEN:
 							status_str = "OPEN";
 							break;
@@ -354,6 +404,30 @@ void PlannerPlan::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_max_depth", "max_depth"), &PlannerPlan::set_max_depth);
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_depth"), "set_max_depth", "get_max_depth");
 
+	ClassDB::bind_method(D_METHOD("get_max_expansions"), &PlannerPlan::get_max_expansions);
+	ClassDB::bind_method(D_METHOD("set_max_expansions", "max_expansions"), &PlannerPlan::set_max_expansions);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_expansions"), "set_max_expansions", "get_max_expansions");
+
+	ClassDB::bind_method(D_METHOD("get_time_budget_usec"), &PlannerPlan::get_time_budget_usec);
+	ClassDB::bind_method(D_METHOD("set_time_budget_usec", "time_budget_usec"), &PlannerPlan::set_time_budget_usec);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "time_budget_usec"), "set_time_budget_usec", "get_time_budget_usec");
+
+	ClassDB::bind_method(D_METHOD("get_parallel_method_depth"), &PlannerPlan::get_parallel_method_depth);
+	ClassDB::bind_method(D_METHOD("set_parallel_method_depth", "depth"), &PlannerPlan::set_parallel_method_depth);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "parallel_method_depth"), "set_parallel_method_depth", "get_parallel_method_depth");
+
+	ClassDB::bind_method(D_METHOD("get_use_state_trail"), &PlannerPlan::get_use_state_trail);
+	ClassDB::bind_method(D_METHOD("set_use_state_trail", "enabled"), &PlannerPlan::set_use_state_trail);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_state_trail"), "set_use_state_trail", "get_use_state_trail");
+
+	ClassDB::bind_method(D_METHOD("get_use_persistent_state"), &PlannerPlan::get_use_persistent_state);
+	ClassDB::bind_method(D_METHOD("set_use_persistent_state", "enabled"), &PlannerPlan::set_use_persistent_state);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_persistent_state"), "set_use_persistent_state", "get_use_persistent_state");
+
+	ClassDB::bind_method(D_METHOD("get_nogood_cache_size"), &PlannerPlan::get_nogood_cache_size);
+	ClassDB::bind_method(D_METHOD("set_nogood_cache_size", "size"), &PlannerPlan::set_nogood_cache_size);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "nogood_cache_size"), "set_nogood_cache_size", "get_nogood_cache_size");
+
 	ClassDB::bind_method(D_METHOD("get_domains"), &PlannerPlan::get_domains);
 	ClassDB::bind_method(D_METHOD("set_domains", "domain"), &PlannerPlan::set_domains);
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "domains", PROPERTY_HINT_RESOURCE_TYPE, "Domain"), "set_domains", "get_domains");
@@ -363,13 +437,39 @@ void PlannerPlan::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "current_domain", PROPERTY_HINT_RESOURCE_TYPE, "Domain"), "set_current_domain", "get_current_domain");
 
 	ClassDB::bind_method(D_METHOD("find_plan", "state", "todo_list"), &PlannerPlan::find_plan);
+	ClassDB::bind_method(D_METHOD("find_plan_async", "state", "todo_list"), &PlannerPlan::find_plan_async);
+	ClassDB::bind_method(D_METHOD("is_async_plan_completed", "task_id"), &PlannerPlan::is_async_plan_completed);
+	ClassDB::bind_method(D_METHOD("wait_for_async_plan", "task_id"), &PlannerPlan::wait_for_async_plan);
+	ClassDB::bind_method(D_METHOD("find_plans", "states", "todo_lists"), &PlannerPlan::find_plans);
 	ClassDB::bind_method(D_METHOD("run_lazy_lookahead", "state", "todo_list", "max_tries"), &PlannerPlan::run_lazy_lookahead, DEFVAL(10));
 	ClassDB::bind_method(D_METHOD("run_lazy_refineahead", "state", "todo_list"), &PlannerPlan::run_lazy_refineahead);
 	ClassDB::bind_method(D_METHOD("generate_plan_id"), &PlannerPlan::generate_plan_id);
 	ClassDB::bind_method(D_METHOD("submit_operation", "operation"), &PlannerPlan::submit_operation);
 	ClassDB::bind_method(D_METHOD("get_global_state"), &PlannerPlan::get_global_state);
+	ClassDB::bind_method(D_METHOD("get_solution_graph"), &PlannerPlan::get_solution_graph);
+	ClassDB::bind_method(D_METHOD("get_state_hash", "state"), &PlannerPlan::get_state_hash);
+	ClassDB::bind_method(D_METHOD("get_last_plan_status"), &PlannerPlan::get_last_plan_status);
+	ClassDB::bind_method(D_METHOD("get_plan_cache_size"), &PlannerPlan::get_plan_cache_size);
+	ClassDB::bind_method(D_METHOD("set_plan_cache_size", "size"), &PlannerPlan::set_plan_cache_size);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "plan_cache_size"), "set_plan_cache_size", "get_plan_cache_size");
+	ClassDB::bind_method(D_METHOD("clear_plan_cache"), &PlannerPlan::clear_plan_cache);
+	ClassDB::bind_method(D_METHOD("get_plan_cache_hit_count"), &PlannerPlan::get_plan_cache_hit_count);
+	ClassDB::bind_method(D_METHOD("get_plan_cache_miss_count"), &PlannerPlan::get_plan_cache_miss_count);
+
+	ClassDB::bind_method(D_METHOD("get_last_expansion_count"), &PlannerPlan::get_last_expansion_count);
+	ClassDB::bind_method(D_METHOD("get_last_nogood_hit_count"), &PlannerPlan::get_last_nogood_hit_count);
+	ClassDB::bind_method(D_METHOD("get_last_nogood_miss_count"), &PlannerPlan::get_last_nogood_miss_count);
+	ClassDB::bind_method(D_METHOD("get_blacklisted_commands"), &PlannerPlan::get_blacklisted_commands);
+	ClassDB::bind_method(D_METHOD("get_blacklisted_command_count"), &PlannerPlan::get_blacklisted_command_count);
+
+	BIND_ENUM_CONSTANT(PLAN_STATUS_NONE);
+	BIND_ENUM_CONSTANT(PLAN_STATUS_SUCCEEDED);
+	BIND_ENUM_CONSTANT(PLAN_STATUS_FAILED);
+	BIND_ENUM_CONSTANT(PLAN_STATUS_EXPANSION_BUDGET_EXHAUSTED);
+	BIND_ENUM_CONSTANT(PLAN_STATUS_TIME_BUDGET_EXHAUSTED);
 
 	ADD_SIGNAL(MethodInfo("plan_id_generated", PropertyInfo(Variant::STRING, "plan_id")));
+	ADD_SIGNAL(MethodInfo("plan_completed", PropertyInfo(Variant::INT, "task_id"), PropertyInfo(Variant::NIL, "plan", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NIL_IS_VARIANT), PropertyInfo(Variant::INT, "status")));
 }
 
 // Temporal method implementations
@@ -445,6 +545,219 @@ void PlannerPlan::set_max_depth(int p_max_depth) {
 	max_depth = p_max_depth;
 }
 
+int PlannerPlan::get_max_expansions() const {
+	return max_expansions;
+}
+
+void PlannerPlan::set_max_expansions(int p_max_expansions) {
+	max_expansions = p_max_expansions;
+}
+
+int PlannerPlan::get_parallel_method_depth() const {
+	return parallel_method_depth;
+}
+
+void PlannerPlan::set_parallel_method_depth(int p_depth) {
+	parallel_method_depth = p_depth;
+}
+
+bool PlannerPlan::get_use_state_trail() const {
+	return use_state_trail;
+}
+
+void PlannerPlan::set_use_state_trail(bool p_enabled) {
+	use_state_trail = p_enabled;
+}
+
+bool PlannerPlan::get_use_persistent_state() const {
+	return use_persistent_state;
+}
+
+void PlannerPlan::set_use_persistent_state(bool p_enabled) {
+	use_persistent_state = p_enabled;
+}
+
+int PlannerPlan::get_nogood_cache_size() const {
+	return nogood_cache_size;
+}
+
+void PlannerPlan::set_nogood_cache_size(int p_size) {
+	nogood_cache_size = MAX(p_size, 0);
+}
+
+int PlannerPlan::get_plan_cache_size() const {
+	return plan_cache_size;
+}
+
+void PlannerPlan::set_plan_cache_size(int p_size) {
+	plan_cache_size = MAX(p_size, 0);
+	if (plan_cache_size > 0) {
+		plan_cache.set_capacity(plan_cache_size);
+	} else {
+		plan_cache.clear();
+	}
+}
+
+void PlannerPlan::clear_plan_cache() {
+	plan_cache.clear();
+	plan_cache_hit_count = 0;
+	plan_cache_miss_count = 0;
+}
+
+int PlannerPlan::get_plan_cache_hit_count() const {
+	return plan_cache_hit_count;
+}
+
+int PlannerPlan::get_plan_cache_miss_count() const {
+	return plan_cache_miss_count;
+}
+
+int64_t PlannerPlan::get_time_budget_usec() const {
+	return time_budget_usec;
+}
+
+void PlannerPlan::set_time_budget_usec(int64_t p_time_budget_usec) {
+	time_budget_usec = p_time_budget_usec;
+}
+
+int64_t PlannerPlan::get_state_hash(const Dictionary &p_state) const {
+	return int64_t(PlannerStateHash::hash_state(p_state));
+}
+
+PlannerPlan::PlanStatus PlannerPlan::get_last_plan_status() const {
+	return last_plan_status;
+}
+
+int PlannerPlan::get_last_expansion_count() const {
+	return last_expansion_count;
+}
+
+TypedArray<Variant> PlannerPlan::get_blacklisted_commands() const {
+	return blacklisted_commands.duplicate();
+}
+
+int PlannerPlan::get_blacklisted_command_count() const {
+	return blacklisted_commands.size();
+}
+
+int PlannerPlan::get_last_nogood_hit_count() const {
+	return last_nogood_hit_count;
+}
+
+int PlannerPlan::get_last_nogood_miss_count() const {
+	return last_nogood_miss_count;
+}
+
+Dictionary PlannerPlan::get_solution_graph() const {
+	return solution_graph.to_dictionary();
+}
+
+Ref<PlannerPlan> PlannerPlan::_create_worker(const Ref<PlannerDomain> &p_domain) const {
+	Ref<PlannerPlan> worker;
+	worker.instantiate();
+	worker->verbose = verbose;
+	worker->verify_goals = verify_goals;
+	worker->max_depth = max_depth;
+	worker->max_expansions = max_expansions;
+	worker->time_budget_usec = time_budget_usec;
+	worker->use_state_trail = use_state_trail;
+	worker->use_persistent_state = use_persistent_state;
+	worker->use_flat_state = use_flat_state;
+	worker->nogood_cache_size = nogood_cache_size;
+	worker->time_range = time_range;
+	worker->current_domain = p_domain;
+	return worker;
+}
+
+int64_t PlannerPlan::find_plan_async(Dictionary p_state, Array p_todo_list) {
+	ERR_FAIL_COND_V_MSG(current_domain.is_null(), -1, "find_plan_async() needs a current domain.");
+
+	AsyncPlanJob *job = memnew(AsyncPlanJob);
+	job->id = next_async_plan_id++;
+	job->owner = Ref<PlannerPlan>(this);
+	job->worker = _create_worker(current_domain->create_snapshot());
+	// The worker must not share containers the caller may keep editing
+	job->state = p_state.duplicate(true);
+	job->todo_list = p_todo_list.duplicate(true);
+	async_jobs.insert(job->id, job);
+
+	job->task_id = WorkerThreadPool::get_singleton()->add_template_task(this, &PlannerPlan::_async_plan_task, job, false, "PlannerPlan::find_plan_async");
+	return job->id;
+}
+
+void PlannerPlan::_async_plan_task(AsyncPlanJob *p_job) {
+	p_job->result = p_job->worker->find_plan(p_job->state, p_job->todo_list);
+	p_job->status = p_job->worker->get_last_plan_status();
+	callable_mp(this, &PlannerPlan::_async_plan_completed).call_deferred(p_job->id);
+}
+
+void PlannerPlan::_async_plan_completed(int64_t p_task_id) {
+	// Already delivered by wait_for_async_plan()
+	if (!async_jobs.has(p_task_id)) {
+		return;
+	}
+	_deliver_async_plan(p_task_id);
+}
+
+Variant PlannerPlan::_deliver_async_plan(int64_t p_task_id) {
+	AsyncPlanJob *job = async_jobs[p_task_id];
+	WorkerThreadPool::get_singleton()->wait_for_task_completion(job->task_id);
+	async_jobs.erase(p_task_id);
+
+	// Hold the reference until the signal is out, the job may be the last owner
+	Ref<PlannerPlan> owner = job->owner;
+	Variant result = job->result;
+	PlanStatus status = job->status;
+	memdelete(job);
+
+	emit_signal("plan_completed", p_task_id, result, status);
+	return result;
+}
+
+bool PlannerPlan::is_async_plan_completed(int64_t p_task_id) const {
+	AsyncPlanJob *const *job = async_jobs.getptr(p_task_id);
+	if (!job) {
+		return true;
+	}
+	return WorkerThreadPool::get_singleton()->is_task_completed((*job)->task_id);
+}
+
+Variant PlannerPlan::wait_for_async_plan(int64_t p_task_id) {
+	ERR_FAIL_COND_V_MSG(!async_jobs.has(p_task_id), Variant(), vformat("No pending async plan with id %d.", p_task_id));
+	return _deliver_async_plan(p_task_id);
+}
+
+Array PlannerPlan::find_plans(Array p_states, Array p_todo_lists) {
+	ERR_FAIL_COND_V_MSG(current_domain.is_null(), Array(), "find_plans() needs a current domain.");
+	ERR_FAIL_COND_V_MSG(p_states.size() != p_todo_lists.size(), Array(), "find_plans() needs one todo list per state.");
+
+	BatchPlanJob job;
+	job.domain = current_domain->create_snapshot();
+	job.states = p_states;
+	job.todo_lists = p_todo_lists;
+	job.results.resize(p_states.size());
+
+	if (!job.results.is_empty()) {
+		WorkerThreadPool::GroupID group_id = WorkerThreadPool::get_singleton()->add_template_group_task(this, &PlannerPlan::_batch_plan_task, &job, job.results.size(), -1, true, "PlannerPlan::find_plans");
+		WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group_id);
+	}
+
+	Array results;
+	results.resize(job.results.size());
+	for (uint32_t i = 0; i < job.results.size(); i++) {
+		results[i] = job.results[i];
+	}
+	return results;
+}
+
+void PlannerPlan::_batch_plan_task(uint32_t p_index, BatchPlanJob *p_job) {
+	// The caller is blocked, so its states and todo lists are only read here
+	Dictionary state = p_job->states[p_index];
+	Array todo_list = p_job->todo_lists[p_index];
+	Ref<PlannerPlan> worker = _create_worker(p_job->domain);
+	p_job->results[p_index] = worker->find_plan(state.duplicate(true), todo_list);
+}
+
 // Graph-based lazy refinement (Elixir-style)
 Dictionary PlannerPlan::run_lazy_refineahead(Dictionary p_state, Array p_todo_list) {
 	if (verbose >= 1) {
@@ -453,9 +766,37 @@ Dictionary PlannerPlan::run_lazy_refineahead(Dictionary p_state, Array p_todo_li
 		print_line("Todo list: " + _item_to_string(p_todo_list));
 	}
 
+	PlanningCursor cursor;
+	_begin_planning(p_state, p_todo_list, cursor);
+	_run_planning_steps(cursor, 0, 0);
+	// The caller may write to the final state, which a node snapshot can still hold
+	cursor.unshare_state();
+	Dictionary final_state = cursor.state;
+
+	// Update time range with end time
+	time_range.set_end_time(PlannerTimeRange::now_microseconds());
+	time_range.calculate_duration();
+
+	if (verbose >= 1) {
+		print_line("run_lazy_refineahead: Completed graph-based planning");
+		print_line("Duration: " + itos(time_range.get_duration()) + " microseconds");
+	}
+
+	return final_state;
+}
+
+void PlannerPlan::_begin_planning(const Dictionary &p_state, const Array &p_todo_list, PlanningCursor &r_cursor) {
 	// Initialize solution graph
 	solution_graph = PlannerSolutionGraph();
 	blacklisted_commands.clear();
+	blacklisted_command_set.clear();
+	method_memo.clear();
+	parallel_domain.unref();
+	nogoods.clear();
+	nogoods.resize(nogood_cache_size);
+	for (uint64_t &nogood : nogoods) {
+		nogood = 0;
+	}
 
 	// Initialize STN solver
 	stn.clear();
@@ -466,119 +807,206 @@ Dictionary PlannerPlan::run_lazy_refineahead(Dictionary p_state, Array p_todo_li
 		time_range.set_start_time(PlannerTimeRange::now_microseconds());
 	}
 
-	// Anchor origin to current absolute time
-	PlannerSTNConstraints::anchor_to_origin(stn, "origin", time_range.get_start_time());
+	// The origin stands for the start time; anchor_to_origin() adds no edge for it
 
 	// Add initial tasks to the solution graph
 	int parent_node_id = 0; // Root node
-	PlannerGraphOperations::add_nodes_and_edges(
-			solution_graph,
-			parent_node_id,
-			p_todo_list,
-			current_domain->action_dictionary,
-			current_domain->task_method_dictionary,
-			current_domain->unigoal_method_dictionary,
-			current_domain->multigoal_method_list);
-
-	// Start planning loop
-	Dictionary final_state = _planning_loop_recursive(parent_node_id, p_state, 0);
+	_add_child_nodes(parent_node_id, p_todo_list);
+
+	r_cursor = PlanningCursor();
+	r_cursor.parent_node_id = parent_node_id;
+	// Methods may write to the live state, so keep the caller's copy untouched
+	r_cursor.state = p_state.duplicate();
+	r_cursor.state_hash = PlannerStateHash::hash_state(r_cursor.state);
+	if (use_persistent_state && !use_state_trail) {
+		r_cursor.persistent_state = PlannerPersistentState::from_dictionary(r_cursor.state);
+	}
+	if (time_budget_usec > 0) {
+		r_cursor.deadline_usec = OS::get_singleton()->get_ticks_usec() + time_budget_usec;
+	}
 
-	// Update time range with end time
-	time_range.set_end_time(PlannerTimeRange::now_microseconds());
-	time_range.calculate_duration();
+	// The layout only grows, so each search starts from an empty one
+	use_flat_state = current_domain->is_compiled();
+	flat_state_layout = PlannerStateLayout();
+	flat_state = PlannerFlatState(&flat_state_layout);
+	flat_state_trail.clear();
+	flat_state_marks.clear();
+	flat_goals.clear();
+	flat_state_valid = false;
+	last_plan_status = PLAN_STATUS_NONE;
+	last_expansion_count = 0;
+	last_nogood_hit_count = 0;
+	last_nogood_miss_count = 0;
+}
 
-	if (verbose >= 1) {
-		print_line("run_lazy_refineahead: Completed graph-based planning");
-		print_line("Duration: " + itos(time_range.get_duration()) + " microseconds");
+bool PlannerPlan::_run_planning_steps(PlanningCursor &r_cursor, int p_max_expansions, uint64_t p_max_usec) {
+	// Iterative driver: each step refines one open node or backtracks, and moves the cursor.
+	// The open nodes in the solution graph are the frontier, so native stack use stays constant
+	// no matter how many expansions or backtracks the search performs.
+	// A slice limit only pauses the loop; the cursor resumes exactly where it stopped.
+	int expansion_limit = p_max_expansions > 0 ? r_cursor.expansions + p_max_expansions : 0;
+	uint64_t slice_deadline_usec = p_max_usec > 0 ? OS::get_singleton()->get_ticks_usec() + p_max_usec : 0;
+	while (!r_cursor.done) {
+		_planning_step(r_cursor);
+		if (expansion_limit > 0 && r_cursor.expansions >= expansion_limit) {
+			break;
+		}
+		if (slice_deadline_usec > 0 && OS::get_singleton()->get_ticks_usec() >= slice_deadline_usec) {
+			break;
+		}
 	}
-
-	return final_state;
+	last_plan_status = r_cursor.status;
+	last_expansion_count = r_cursor.expansions;
+	last_nogood_hit_count = r_cursor.nogood_hits;
+	last_nogood_miss_count = r_cursor.nogood_misses;
+	return r_cursor.done;
 }
 
-Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionary p_state, int p_iter) {
-	// Check depth limit to prevent infinite recursion
-	if (p_iter >= max_depth) {
+void PlannerPlan::_planning_step(PlanningCursor &r_cursor) {
+	const int parent_node_id = r_cursor.parent_node_id;
+	Dictionary &state = r_cursor.state;
+	const bool persistent_snapshots = use_persistent_state && !use_state_trail;
+
+	// Stop once the expansion or wall-clock budget is spent; the graph keeps its open nodes
+	const int expansions = shared_expansions ? shared_expansions->load() : r_cursor.expansions;
+	if (max_expansions > 0 && expansions >= max_expansions) {
 		if (verbose >= 1) {
-			ERR_PRINT(vformat("Planning depth limit (%d) exceeded, aborting", max_depth));
+			print_line(vformat("Expansion budget (%d) exhausted, aborting", max_expansions));
 		}
-		return p_state;
+		r_cursor.finish(PLAN_STATUS_EXPANSION_BUDGET_EXHAUSTED);
+		return;
+	}
+	if (r_cursor.deadline_usec > 0 && OS::get_singleton()->get_ticks_usec() >= r_cursor.deadline_usec) {
+		if (verbose >= 1) {
+			print_line(vformat("Time budget (%d usec) exhausted, aborting", time_budget_usec));
+		}
+		r_cursor.finish(PLAN_STATUS_TIME_BUDGET_EXHAUSTED);
+		return;
 	}
 
 	if (verbose >= 2) {
-		print_line(vformat("_planning_loop_recursive: parent_node_id=%d, iter=%d", p_parent_node_id, p_iter));
+		print_line(vformat("_planning_step: parent_node_id=%d, iter=%d", parent_node_id, r_cursor.iteration));
 	}
 
 	// Find the first Open node
-	Variant open_node_result = PlannerGraphOperations::find_open_node(solution_graph, p_parent_node_id);
+	Variant open_node_result = PlannerGraphOperations::find_open_node(solution_graph, parent_node_id);
 
 	if (open_node_result.get_type() == Variant::NIL) {
 		// No open node found, check if parent is root
-		Dictionary parent_node = solution_graph.get_node(p_parent_node_id);
-		int parent_type = parent_node["type"];
-
-		if (parent_type == static_cast<int>(PlannerNodeType::TYPE_ROOT)) {
+		if (solution_graph.get_node_type(parent_node_id) == PlannerNodeType::TYPE_ROOT) {
 			// Planning complete
 			if (verbose >= 1) {
 				print_line("Planning complete, returning final state");
 			}
-			return p_state;
+			r_cursor.finish(PLAN_STATUS_SUCCEEDED);
+			return;
 		} else {
 			// Move to predecessor
-			int new_parent = PlannerGraphOperations::find_predecessor(solution_graph, p_parent_node_id);
+			int new_parent = PlannerGraphOperations::find_predecessor(solution_graph, parent_node_id);
 			if (new_parent >= 0) {
-				return _planning_loop_recursive(new_parent, p_state, p_iter + 1);
+				r_cursor.advance(new_parent);
+				return;
 			}
-			return p_state;
+			r_cursor.finish(PLAN_STATUS_FAILED);
+			return;
 		}
 	}
 
 	int curr_node_id = open_node_result;
-	Dictionary curr_node = solution_graph.get_node(curr_node_id);
 
+	// Nodes below the depth limit fail so that shallower alternatives are tried
+	if (max_depth > 0 && solution_graph.get_node_depth(curr_node_id) > max_depth) {
+		if (verbose >= 2) {
+			print_line(vformat("Node %d exceeds depth limit (%d), backtracking", curr_node_id, max_depth));
+		}
+		_backtrack(r_cursor, curr_node_id);
+		return;
+	}
+
+	r_cursor.expansions++;
+	if (shared_expansions) {
+		shared_expansions->fetch_add(1);
+	}
 	if (verbose >= 2) {
-		print_line(vformat("Iteration %d: Refining node %d", p_iter, curr_node_id));
+		print_line(vformat("Iteration %d: Refining node %d", r_cursor.iteration, curr_node_id));
 	}
 
-	// Save current state if first visit (state is empty)
-	Dictionary node_state = solution_graph.get_state_snapshot(curr_node_id);
-	if (node_state.is_empty()) {
-		solution_graph.save_state_snapshot(curr_node_id, p_state.duplicate());
-		// Also save STN snapshot on first visit
-		PlannerSTNSolver::Snapshot snapshot = stn.create_snapshot();
-		curr_node["stn_snapshot"] = snapshot.to_dictionary();
-		solution_graph.update_node(curr_node_id, curr_node);
+	// Save current state if first visit (no snapshot yet)
+	if (!solution_graph.has_snapshot(curr_node_id)) {
+		if (use_state_trail) {
+			solution_graph.save_trail_mark(curr_node_id, solution_graph.get_state_trail_size());
+		} else if (persistent_snapshots) {
+			solution_graph.save_persistent_snapshot(curr_node_id, r_cursor.persistent_state);
+		} else {
+			solution_graph.save_state_snapshot(curr_node_id, state);
+			r_cursor.state_shared = true;
+		}
+		solution_graph.save_state_hash(curr_node_id, r_cursor.state_hash);
+		if (use_flat_state) {
+			if (!flat_state_valid) {
+				_rebuild_flat_state(state);
+			}
+			flat_state_marks.insert(curr_node_id, flat_state_trail.size());
+		}
+		// Also save the STN on first visit, as an undo level in trail mode
+		if (use_state_trail) {
+			solution_graph.save_stn_level(curr_node_id, stn.get_level_count());
+			stn.push_level();
+		} else {
+			solution_graph.save_stn_snapshot(curr_node_id, stn.create_snapshot());
+		}
+
+		// The same item already failed from this state at this depth on another path
+		PlannerNodeType node_type = solution_graph.get_node_type(curr_node_id);
+		if (!nogoods.is_empty() && (node_type == PlannerNodeType::TYPE_TASK || node_type == PlannerNodeType::TYPE_GOAL || node_type == PlannerNodeType::TYPE_MULTIGOAL)) {
+			if (_is_nogood(curr_node_id)) {
+				r_cursor.nogood_hits++;
+				if (verbose >= 2) {
+					print_line(vformat("Node %d is a known failure, backtracking", curr_node_id));
+				}
+				_backtrack(r_cursor, curr_node_id);
+				return;
+			}
+			r_cursor.nogood_misses++;
+		}
 	} else {
 		// Restore state if backtracking
-		p_state = node_state.duplicate();
+		if (use_state_trail) {
+			solution_graph.undo_state_changes(state, solution_graph.get_trail_mark(curr_node_id));
+		} else {
+			// The snapshot is restored by reference and only copied if a method runs on it;
+			// a persistent version is converted into a new Dictionary
+			if (persistent_snapshots) {
+				r_cursor.persistent_state = *solution_graph.get_persistent_snapshot(curr_node_id);
+			}
+			state = solution_graph.get_state_snapshot(curr_node_id);
+			r_cursor.state_shared = !persistent_snapshots;
+		}
+		r_cursor.state_hash = solution_graph.get_state_hash(curr_node_id);
+		if (use_flat_state) {
+			_restore_flat_state(curr_node_id, state);
+		}
 		// Also restore STN snapshot
 		_restore_stn_from_node(curr_node_id);
 	}
 
-	int node_type = curr_node["type"];
-
 	// Handle different node types
-	switch (static_cast<PlannerNodeType>(node_type)) {
+	switch (solution_graph.get_node_type(curr_node_id)) {
 		case PlannerNodeType::TYPE_TASK: {
 			// Try to refine task with available methods (like Elixir's Enum.find_value)
-			Variant task_info = curr_node["info"];
+			Variant task_info = solution_graph.get_node_info(curr_node_id);
 
 			// Extract metadata and validate entity requirements (use original task_info for metadata extraction to preserve constraints)
 			PlannerMetadata metadata = _extract_metadata(task_info);
-			if (!_validate_entity_requirements(p_state, metadata)) {
+			if (!_validate_entity_requirements(state, metadata)) {
 				if (verbose >= 2) {
 					print_line("Task entity requirements not met, backtracking");
 				}
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 
-			TypedArray<Callable> available_methods = curr_node["available_methods"];
+			const TypedArray<Callable> &available_methods = solution_graph.get_available_methods(curr_node_id);
 
 			// Unwrap task_info if it's in dictionary format
 			Variant actual_task_info = task_info;
@@ -591,21 +1019,44 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 
 			// Try all available methods (like Elixir's Enum.find_value)
 			// Don't modify available_methods - keep full list for backtracking
-			Callable selected_method;
+			// Resume after the previously selected method when reopened by backtracking
+			int selected_method_index = -1;
+			int first_method_index = solution_graph.get_selected_method_index(curr_node_id) + 1;
 			Array subtasks;
 			bool found_working_method = false;
 
-			for (int i = 0; i < available_methods.size(); i++) {
-				Callable method = available_methods[i];
-				Array task_arr = actual_task_info;
-				Array args;
-				args.push_back(p_state);
-				args.append_array(task_arr.slice(1));
+			if (_should_refine_in_parallel(curr_node_id, first_method_index)) {
+				_refine_in_parallel(r_cursor, curr_node_id, first_method_index);
+				return;
+			}
 
-				Variant result = method.callv(args);
+			for (int i = first_method_index; i < available_methods.size(); i++) {
+				Callable method = available_methods[i];
+				Variant result;
+
+				// A pure method gives the same result for the same task and state, so it runs once per search
+				bool is_pure = current_domain->pure_methods.has(method);
+				uint64_t memo_key = 0;
+				const Variant *memoized_result = nullptr;
+				if (is_pure) {
+					memo_key = PlannerStateHash::combine(PlannerStateHash::combine(r_cursor.state_hash, method.hash()), actual_task_info.hash());
+					memoized_result = method_memo.getptr(memo_key);
+				}
+				if (memoized_result) {
+					result = *memoized_result;
+				} else {
+					// Methods may write to their state argument; a pure method does not
+					if (!is_pure) {
+						r_cursor.unshare_state();
+					}
+					result = _call_with_item(method, state, actual_task_info);
+					if (is_pure) {
+						method_memo.insert(memo_key, result);
+					}
+				}
 				if (result.get_type() == Variant::ARRAY) {
 					subtasks = result;
-					selected_method = method;
+					selected_method_index = i;
 					found_working_method = true;
 					break; // Found working method, stop trying
 				}
@@ -614,63 +1065,36 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 
 			if (found_working_method) {
 				// Successfully refined - like Elixir's {method, subtasks}
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-				curr_node["selected_method"] = selected_method;
-				// Don't modify available_methods - keep full list for potential backtracking
-				solution_graph.update_node(curr_node_id, curr_node);
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
+				solution_graph.set_selected_method_index(curr_node_id, selected_method_index);
 
 				// Add subtasks to graph
-				PlannerGraphOperations::add_nodes_and_edges(
-						solution_graph,
-						curr_node_id,
-						subtasks,
-						current_domain->action_dictionary,
-						current_domain->task_method_dictionary,
-						current_domain->unigoal_method_dictionary,
-						current_domain->multigoal_method_list);
+				_add_child_nodes(curr_node_id, subtasks);
 
-				return _planning_loop_recursive(curr_node_id, p_state, p_iter + 1);
+				r_cursor.advance(curr_node_id);
+				return;
 			}
 
 			// Failed to refine, backtrack
 			if (verbose >= 2) {
 				print_line("Task refinement failed, backtracking");
 			}
-			PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-					solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-			solution_graph = backtrack_result.graph;
-			if (backtrack_result.parent_node_id >= 0) {
-				// Restore STN snapshot from the node we're backtracking to
-				_restore_stn_from_node(backtrack_result.parent_node_id);
-				return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-			}
-			return p_state;
+			_backtrack(r_cursor, curr_node_id);
+			return;
 		}
 
 		case PlannerNodeType::TYPE_ACTION: {
-			Variant action_info = curr_node["info"];
+			Variant action_info = solution_graph.get_node_info(curr_node_id);
 
 			// Check if blacklisted
 			if (_is_command_blacklisted(action_info)) {
 				if (verbose >= 2) {
 					print_line("Action is blacklisted, backtracking");
 				}
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					// Restore STN snapshot from the node we're backtracking to
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 
-			// Create STN snapshot before action execution and store with node
-			stn_snapshot = stn.create_snapshot();
-			curr_node["stn_snapshot"] = stn_snapshot.to_dictionary();
-			solution_graph.update_node(curr_node_id, curr_node);
-
 			// Check for temporal constraints and entity requirements in action
 			PlannerMetadata metadata = _extract_metadata(action_info);
 			Dictionary temporal_metadata;
@@ -679,22 +1103,16 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 			}
 
 			// Validate entity requirements before executing action
-			if (!_validate_entity_requirements(p_state, metadata)) {
+			if (!_validate_entity_requirements(state, metadata)) {
 				if (verbose >= 2) {
 					print_line("Action entity requirements not met, backtracking");
 				}
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 
 			// Execute action with temporal tracking
-			Callable action = curr_node["action"];
+			Callable action = solution_graph.get_action(curr_node_id);
 			// Unwrap action_info if it's in dictionary format
 			Variant actual_action_info = action_info;
 			if (action_info.get_type() == Variant::DICTIONARY) {
@@ -711,22 +1129,11 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 					String action_name = action_arr.is_empty() ? "unknown" : String(action_arr[0]);
 					print_line(vformat("Action '%s' not found in domain, marking as failed", action_name));
 				}
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_FAILED);
-				solution_graph.update_node(curr_node_id, curr_node);
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_FAILED);
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 
-			Array args;
-			args.push_back(p_state);
-			args.append_array(action_arr.slice(1));
-
 			// Use temporal metadata start_time if provided, otherwise use current time
 			int64_t action_start_time;
 			if (temporal_metadata.has("start_time")) {
@@ -737,10 +1144,13 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 
 			if (verbose >= 2) {
 				String action_name = action_arr.is_empty() ? "unknown" : String(action_arr[0]);
-				print_line(vformat("Executing action '%s' with args: %s", action_name, _item_to_string(args.slice(1))));
+				print_line(vformat("Executing action '%s' with args: %s", action_name, _item_to_string(action_arr.slice(1))));
 			}
 
-			Variant result = action.callv(args);
+			// Actions may set variables on the state they are given before returning it, so they
+			// get a copy of its top level. Nested dictionaries are shared with the parent state:
+			// an action replaces the ones it changes, which the diff below then finds by identity.
+			Variant result = _call_with_item(action, state.duplicate(), action_arr);
 
 			// Use temporal metadata end_time if provided, otherwise use current time
 			int64_t action_end_time;
@@ -783,34 +1193,20 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 							print_line("Failed to add interval to STN, backtracking");
 						}
 						_blacklist_command(action_info);
-						stn.restore_snapshot(stn_snapshot);
-						PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-								solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-						solution_graph = backtrack_result.graph;
-						if (backtrack_result.parent_node_id >= 0) {
-							_restore_stn_from_node(backtrack_result.parent_node_id);
-							return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-						}
-						return p_state;
+						_restore_stn_from_node(curr_node_id);
+						_backtrack(r_cursor, curr_node_id);
+						return;
 					}
 
-					// Check STN consistency only if we added temporal constraints
-					stn.check_consistency();
+					// add_interval propagates each new edge, so the flag is already current
 					if (!stn.is_consistent()) {
 						// STN inconsistent, backtrack
 						if (verbose >= 2) {
 							print_line("STN inconsistent after action, backtracking");
 						}
 						_blacklist_command(action_info);
-						PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-								solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-						solution_graph = backtrack_result.graph;
-						if (backtrack_result.parent_node_id >= 0) {
-							// Restore STN snapshot from the node we're backtracking to
-							_restore_stn_from_node(backtrack_result.parent_node_id);
-							return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-						}
-						return p_state;
+						_backtrack(r_cursor, curr_node_id);
+						return;
 					}
 				} else {
 					// Action has no temporal constraints - can occur at any time
@@ -822,17 +1218,36 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 				}
 
 				// Action successful and STN consistent
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-				curr_node["start_time"] = action_start_time;
-				curr_node["end_time"] = action_end_time;
-				curr_node["duration"] = action_duration;
-				solution_graph.update_node(curr_node_id, curr_node);
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
+				solution_graph.set_action_times(curr_node_id, action_start_time, action_end_time, action_duration);
 
 				// Update plan time range
 				time_range.set_end_time(action_end_time);
 				time_range.calculate_duration();
 
-				return _planning_loop_recursive(p_parent_node_id, new_state, p_iter + 1);
+				// One walk over the action's changes updates the hash, the flat state and either the undo trail or the persistent version
+				uint64_t state_hash = r_cursor.state_hash;
+				planner_for_each_state_change(state, new_state, [&](const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value) {
+					state_hash ^= PlannerStateHash::change_key(p_variable, p_argument, p_old_value, p_new_value);
+					if (use_state_trail) {
+						solution_graph.record_state_change(p_variable, p_argument, p_old_value);
+					} else if (persistent_snapshots) {
+						PlannerPersistentState &persistent_state = r_cursor.persistent_state;
+						if (p_argument) {
+							persistent_state = p_new_value ? persistent_state.with_value(p_variable, *p_argument, *p_new_value) : persistent_state.without_value(p_variable, *p_argument);
+						} else {
+							persistent_state = p_new_value ? persistent_state.with_variable(p_variable, *p_new_value) : persistent_state.without_variable(p_variable);
+						}
+					}
+					if (use_flat_state) {
+						_record_flat_state_change(p_variable, p_argument, p_old_value, p_new_value);
+					}
+				});
+				r_cursor.state_hash = state_hash;
+				state = new_state;
+				r_cursor.state_shared = false;
+				r_cursor.advance(parent_node_id);
+				return;
 			} else {
 				// Action failed, backtrack and restore STN
 				String action_name = action_arr.is_empty() ? "unknown" : String(action_arr[0]);
@@ -840,26 +1255,19 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 					print_line(vformat("Action '%s' failed (returned %s, expected Dictionary), backtracking",
 							action_name, Variant::get_type_name(result.get_type())));
 					if (verbose >= 2) {
-						print_line(vformat("  Action args: %s", _item_to_string(args.slice(1))));
-						print_line(vformat("  Current state: %s", _item_to_string(p_state)));
+						print_line(vformat("  Action args: %s", _item_to_string(action_arr.slice(1))));
+						print_line(vformat("  Current state: %s", _item_to_string(state)));
 					}
 				}
 				_blacklist_command(action_info);
-				stn.restore_snapshot(stn_snapshot);
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					// Restore STN snapshot from the node we're backtracking to
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_restore_stn_from_node(curr_node_id);
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 		}
 
 		case PlannerNodeType::TYPE_GOAL: {
-			Variant goal_info = curr_node["info"];
+			Variant goal_info = solution_graph.get_node_info(curr_node_id);
 
 			// Unwrap goal_info if it's in dictionary format
 			Variant actual_goal_info = goal_info;
@@ -873,7 +1281,8 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 			Array goal_arr = actual_goal_info;
 			if (goal_arr.size() < 3) {
 				// Invalid goal format
-				return p_state;
+				r_cursor.finish(PLAN_STATUS_FAILED);
+				return;
 			}
 
 			String state_var_name = goal_arr[0];
@@ -882,43 +1291,57 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 
 			// Extract metadata and validate entity requirements (use original goal_info for metadata extraction)
 			PlannerMetadata metadata = _extract_metadata(goal_info);
-			if (!_validate_entity_requirements(p_state, metadata)) {
+			if (!_validate_entity_requirements(state, metadata)) {
 				if (verbose >= 2) {
 					print_line("Goal entity requirements not met, backtracking");
 				}
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 
 			// Check if goal already achieved
-			Dictionary state_var = p_state[state_var_name];
-			if (state_var[argument] == desired_value) {
+			bool goal_achieved;
+			if (use_flat_state) {
+				goal_achieved = flat_state.is_goal_achieved(_get_flat_goals(curr_node_id, actual_goal_info)[0]);
+			} else {
+				Dictionary state_var = state[state_var_name];
+				goal_achieved = state_var[argument] == desired_value;
+			}
+			if (goal_achieved) {
 				// Goal already achieved
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-				solution_graph.update_node(curr_node_id, curr_node);
-				return _planning_loop_recursive(curr_node_id, p_state, p_iter + 1);
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
+				r_cursor.advance(curr_node_id);
+				return;
 			}
 
 			// Try to refine goal (like Elixir's Enum.find_value)
-			TypedArray<Callable> available_methods = curr_node["available_methods"];
+			const TypedArray<Callable> &available_methods = solution_graph.get_available_methods(curr_node_id);
 
 			// Try all available methods - don't modify available_methods
-			Callable selected_method;
+			// Resume after the previously selected method when reopened by backtracking
+			int selected_method_index = -1;
+			int first_method_index = solution_graph.get_selected_method_index(curr_node_id) + 1;
 			Array subgoals;
 			bool found_working_method = false;
 
-			for (int i = 0; i < available_methods.size(); i++) {
+			if (_should_refine_in_parallel(curr_node_id, first_method_index)) {
+				_refine_in_parallel(r_cursor, curr_node_id, first_method_index);
+				return;
+			}
+
+			// Native methods get the same arguments as Callables, not the raw goal item
+			Array native_goal_item;
+			r_cursor.unshare_state();
+			for (int i = first_method_index; i < available_methods.size(); i++) {
 				Callable method = available_methods[i];
-				Variant result = method.call(p_state, argument, desired_value);
+				const PlannerDomain::NativeCall *native_call = current_domain->get_native_call(method);
+				if (native_call && native_goal_item.is_empty()) {
+					native_goal_item = varray(goal_arr[0], argument, desired_value);
+				}
+				Variant result = native_call ? native_call->call(state, native_goal_item) : method.call(state, argument, desired_value);
 				if (result.get_type() == Variant::ARRAY) {
 					subgoals = result;
-					selected_method = method;
+					selected_method_index = i;
 					found_working_method = true;
 					break;
 				}
@@ -927,41 +1350,26 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 
 			if (found_working_method) {
 				// Successfully refined
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-				curr_node["selected_method"] = selected_method;
-				// Don't modify available_methods
-				solution_graph.update_node(curr_node_id, curr_node);
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
+				solution_graph.set_selected_method_index(curr_node_id, selected_method_index);
 
 				// Add subgoals to graph
-				PlannerGraphOperations::add_nodes_and_edges(
-						solution_graph,
-						curr_node_id,
-						subgoals,
-						current_domain->action_dictionary,
-						current_domain->task_method_dictionary,
-						current_domain->unigoal_method_dictionary,
-						current_domain->multigoal_method_list);
+				_add_child_nodes(curr_node_id, subgoals);
 
-				return _planning_loop_recursive(curr_node_id, p_state, p_iter + 1);
+				r_cursor.advance(curr_node_id);
+				return;
 			}
 
 			// Failed to refine, backtrack
 			if (verbose >= 2) {
 				print_line("Goal refinement failed, backtracking");
 			}
-			PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-					solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-			solution_graph = backtrack_result.graph;
-			if (backtrack_result.parent_node_id >= 0) {
-				// Restore STN snapshot from the node we're backtracking to
-				_restore_stn_from_node(backtrack_result.parent_node_id);
-				return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-			}
-			return p_state;
+			_backtrack(r_cursor, curr_node_id);
+			return;
 		}
 
 		case PlannerNodeType::TYPE_MULTIGOAL: {
-			Variant multigoal_variant = curr_node["info"];
+			Variant multigoal_variant = solution_graph.get_node_info(curr_node_id);
 
 			// Unwrap if dictionary-wrapped
 			if (multigoal_variant.get_type() == Variant::DICTIONARY) {
@@ -972,63 +1380,59 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 			}
 
 			if (!PlannerMultigoal::is_multigoal_dict(multigoal_variant)) {
-				return p_state;
+				r_cursor.finish(PLAN_STATUS_FAILED);
+				return;
 			}
 			Dictionary multigoal = multigoal_variant;
 
 			// Extract metadata from multigoal and validate entity requirements
 			// Multigoal metadata might be stored in the multigoal dictionary itself
 			PlannerMetadata metadata = _extract_metadata(multigoal_variant);
-			if (!_validate_entity_requirements(p_state, metadata)) {
+			if (!_validate_entity_requirements(state, metadata)) {
 				if (verbose >= 2) {
 					print_line("MultiGoal entity requirements not met, backtracking");
 				}
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 
 			// Check if multigoal already achieved
-			Dictionary goals_not_achieved = PlannerMultigoal::method_goals_not_achieved(p_state, multigoal);
-			if (goals_not_achieved.is_empty()) {
+			bool goals_achieved;
+			if (use_flat_state) {
+				goals_achieved = flat_state.are_goals_achieved(_get_flat_goals(curr_node_id, multigoal));
+			} else {
+				goals_achieved = PlannerMultigoal::method_goals_not_achieved(state, multigoal).is_empty();
+			}
+			if (goals_achieved) {
 				// All goals are already achieved
 				if (verbose >= 1) {
 					print_line("MultiGoal already achieved, marking as closed");
 				}
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-				solution_graph.update_node(curr_node_id, curr_node);
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
 				// Add empty subgoals for verification node (like Elixir)
 				Array empty_subgoals;
-				PlannerGraphOperations::add_nodes_and_edges(
-						solution_graph,
-						curr_node_id,
-						empty_subgoals,
-						current_domain->action_dictionary,
-						current_domain->task_method_dictionary,
-						current_domain->unigoal_method_dictionary,
-						current_domain->multigoal_method_list);
-				return _planning_loop_recursive(curr_node_id, p_state, p_iter + 1);
+				_add_child_nodes(curr_node_id, empty_subgoals);
+				r_cursor.advance(curr_node_id);
+				return;
 			}
 
 			// Try to refine multigoal (like Elixir's Enum.find_value)
-			TypedArray<Callable> available_methods = curr_node["available_methods"];
+			const TypedArray<Callable> &available_methods = solution_graph.get_available_methods(curr_node_id);
 
 			// Try all available methods - don't modify available_methods
-			Callable selected_method;
+			// Resume after the previously selected method when reopened by backtracking
+			int selected_method_index = -1;
+			int first_method_index = solution_graph.get_selected_method_index(curr_node_id) + 1;
 			Array subgoals;
 			bool found_working_method = false;
 
-			for (int i = 0; i < available_methods.size(); i++) {
+			r_cursor.unshare_state();
+			for (int i = first_method_index; i < available_methods.size(); i++) {
 				Callable method = available_methods[i];
-				Variant result = method.call(p_state, multigoal);
+				Variant result = method.call(state, multigoal);
 				if (result.get_type() == Variant::ARRAY) {
 					subgoals = result;
-					selected_method = method;
+					selected_method_index = i;
 					found_working_method = true;
 					break;
 				}
@@ -1037,58 +1441,48 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 
 			if (found_working_method) {
 				// Successfully refined
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-				curr_node["selected_method"] = selected_method;
-				// Don't modify available_methods
-				solution_graph.update_node(curr_node_id, curr_node);
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
+				solution_graph.set_selected_method_index(curr_node_id, selected_method_index);
 
 				// Optimize unigoal order (most constraining first) before adding to graph
 				Array optimized_subgoals = _optimize_unigoal_order(
-						subgoals, p_state, current_domain->unigoal_method_dictionary);
+						subgoals, state, current_domain->unigoal_method_dictionary);
 
 				// Add optimized subgoals to graph
-				PlannerGraphOperations::add_nodes_and_edges(
-						solution_graph,
-						curr_node_id,
-						optimized_subgoals,
-						current_domain->action_dictionary,
-						current_domain->task_method_dictionary,
-						current_domain->unigoal_method_dictionary,
-						current_domain->multigoal_method_list);
+				_add_child_nodes(curr_node_id, optimized_subgoals);
 
-				return _planning_loop_recursive(curr_node_id, p_state, p_iter + 1);
+				r_cursor.advance(curr_node_id);
+				return;
 			}
 
 			// Failed to refine, backtrack
 			if (verbose >= 2) {
 				print_line("MultiGoal refinement failed, backtracking");
 			}
-			PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-					solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-			solution_graph = backtrack_result.graph;
-			if (backtrack_result.parent_node_id >= 0) {
-				// Restore STN snapshot from the node we're backtracking to
-				_restore_stn_from_node(backtrack_result.parent_node_id);
-				return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-			}
-			return p_state;
+			_backtrack(r_cursor, curr_node_id);
+			return;
 		}
 
 		case PlannerNodeType::TYPE_VERIFY_GOAL: {
 			// Verify the parent goal
-			Dictionary parent_node = solution_graph.get_node(p_parent_node_id);
-			Array goal_arr = parent_node["info"];
+			Array goal_arr = solution_graph.get_node_info(parent_node_id);
 			if (goal_arr.size() >= 3) {
 				String state_var_name = goal_arr[0];
 				String argument = goal_arr[1];
 				Variant desired_value = goal_arr[2];
 
-				Dictionary state_var = p_state[state_var_name];
-				if (state_var[argument] == desired_value) {
+				bool goal_achieved;
+				if (use_flat_state) {
+					goal_achieved = flat_state.is_goal_achieved(_get_flat_goals(parent_node_id, goal_arr)[0]);
+				} else {
+					Dictionary state_var = state[state_var_name];
+					goal_achieved = state_var[argument] == desired_value;
+				}
+				if (goal_achieved) {
 					// Verification successful
-					curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-					solution_graph.update_node(curr_node_id, curr_node);
-					return _planning_loop_recursive(p_parent_node_id, p_state, p_iter + 1);
+					solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
+					r_cursor.advance(parent_node_id);
+					return;
 				}
 			}
 
@@ -1096,21 +1490,13 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 			if (verbose >= 2) {
 				print_line("Goal verification failed, backtracking");
 			}
-			PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-					solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-			solution_graph = backtrack_result.graph;
-			if (backtrack_result.parent_node_id >= 0) {
-				// Restore STN snapshot from the node we're backtracking to
-				_restore_stn_from_node(backtrack_result.parent_node_id);
-				return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-			}
-			return p_state;
+			_backtrack(r_cursor, curr_node_id);
+			return;
 		}
 
 		case PlannerNodeType::TYPE_VERIFY_MULTIGOAL: {
 			// Verify the parent multigoal
-			Dictionary parent_node = solution_graph.get_node(p_parent_node_id);
-			Variant multigoal_variant = parent_node["info"];
+			Variant multigoal_variant = solution_graph.get_node_info(parent_node_id);
 
 			// Unwrap if dictionary-wrapped
 			if (multigoal_variant.get_type() == Variant::DICTIONARY) {
@@ -1125,113 +1511,386 @@ Dictionary PlannerPlan::_planning_loop_recursive(int p_parent_node_id, Dictionar
 				if (verbose >= 2) {
 					print_line("MultiGoal verification failed: invalid parent multigoal, backtracking");
 				}
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					// Restore STN snapshot from the node we're backtracking to
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 			Dictionary multigoal = multigoal_variant;
 
-			Dictionary goals_not_achieved = PlannerMultigoal::method_goals_not_achieved(p_state, multigoal);
-			if (goals_not_achieved.is_empty()) {
+			bool goals_achieved;
+			if (use_flat_state) {
+				goals_achieved = flat_state.are_goals_achieved(_get_flat_goals(parent_node_id, multigoal));
+			} else {
+				goals_achieved = PlannerMultigoal::method_goals_not_achieved(state, multigoal).is_empty();
+			}
+			if (goals_achieved) {
 				// Verification successful - all goals are achieved
 				if (verbose >= 1) {
 					print_line("MultiGoal verified successfully");
 				}
-				curr_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_CLOSED);
-				solution_graph.update_node(curr_node_id, curr_node);
-				return _planning_loop_recursive(p_parent_node_id, p_state, p_iter + 1);
+				solution_graph.set_node_status(curr_node_id, PlannerNodeStatus::STATUS_CLOSED);
+				r_cursor.advance(parent_node_id);
+				return;
 			} else {
 				// Verification failed - some goals not achieved
 				if (verbose >= 2) {
 					print_line("MultiGoal verification failed: some goals not achieved, backtracking");
 				}
-				PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(
-						solution_graph, p_parent_node_id, curr_node_id, p_state, blacklisted_commands);
-				solution_graph = backtrack_result.graph;
-				if (backtrack_result.parent_node_id >= 0) {
-					// Restore STN snapshot from the node we're backtracking to
-					_restore_stn_from_node(backtrack_result.parent_node_id);
-					return _planning_loop_recursive(backtrack_result.parent_node_id, backtrack_result.state, p_iter + 1);
-				}
-				return p_state;
+				_backtrack(r_cursor, curr_node_id);
+				return;
 			}
 		}
 
 		default:
-			return p_state;
+			r_cursor.finish(PLAN_STATUS_FAILED);
+			return;
 	}
 }
 
 void PlannerPlan::_restore_stn_from_node(int p_node_id) {
-	if (p_node_id >= 0) {
-		Dictionary node = solution_graph.get_node(p_node_id);
-		if (node.has("stn_snapshot")) {
-			Dictionary snapshot_dict = node["stn_snapshot"];
-			PlannerSTNSolver::Snapshot snapshot = PlannerSTNSolver::Snapshot::from_dictionary(snapshot_dict);
-			stn.restore_snapshot(snapshot);
+	if (p_node_id < 0) {
+		return;
+	}
+	if (use_state_trail) {
+		int level = solution_graph.get_stn_level(p_node_id);
+		if (level >= 0) {
+			// Undo everything since the node's first visit, keeping its level open for the next revisit
+			while (stn.get_level_count() > level) {
+				stn.pop_level();
+			}
+			stn.push_level();
 			if (verbose >= 3) {
-				print_line("Restored STN snapshot from node " + itos(p_node_id));
+				print_line("Restored STN level " + itos(level) + " from node " + itos(p_node_id));
 			}
 		}
+		return;
+	}
+	const PlannerSTNSolver::Snapshot *snapshot = solution_graph.get_stn_snapshot(p_node_id);
+	if (snapshot) {
+		stn.restore_snapshot(*snapshot);
+		if (verbose >= 3) {
+			print_line("Restored STN snapshot from node " + itos(p_node_id));
+		}
 	}
 }
 
-bool PlannerPlan::_is_command_blacklisted(Variant p_command) const {
-	// Unwrap if dictionary-wrapped
-	Variant actual_command = p_command;
-	if (p_command.get_type() == Variant::DICTIONARY) {
-		Dictionary dict = p_command;
-		if (dict.has("item")) {
-			actual_command = dict["item"];
+void PlannerPlan::_rebuild_flat_state(const Dictionary &p_state) {
+	flat_state = PlannerFlatState::from_dictionary(&flat_state_layout, p_state);
+	flat_state_trail.clear();
+	flat_state_marks.clear();
+	flat_state_valid = true;
+}
+
+void PlannerPlan::_write_flat_slot(int p_slot, const Variant *p_value) {
+	FlatStateChange change;
+	change.slot = p_slot;
+	change.had_value = flat_state.has_value(p_slot);
+	if (change.had_value) {
+		change.old_value = flat_state.get_value(p_slot);
+	}
+	flat_state_trail.push_back(change);
+	if (p_value) {
+		flat_state.set_value(p_slot, *p_value);
+	} else {
+		flat_state.clear_value(p_slot);
+	}
+}
+
+void PlannerPlan::_record_flat_state_change(const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value) {
+	if (p_argument) {
+		_write_flat_slot(flat_state_layout.intern_slot(p_variable, *p_argument), p_new_value);
+		return;
+	}
+	// The whole variable changed: clear what the old value stored, then store the new one
+	int predicate_id = flat_state_layout.intern_predicate(p_variable);
+	if (p_old_value && p_old_value->get_type() == Variant::DICTIONARY) {
+		Dictionary old_arguments = *p_old_value;
+		for (const Variant *argument = old_arguments.next(nullptr); argument; argument = old_arguments.next(argument)) {
+			_write_flat_slot(flat_state_layout.intern_slot(predicate_id, flat_state_layout.intern_argument(*argument)), nullptr);
+		}
+	} else if (p_old_value) {
+		_write_flat_slot(flat_state_layout.intern_slot(predicate_id, PlannerStateLayout::NO_ARGUMENT), nullptr);
+	}
+	if (p_new_value && p_new_value->get_type() == Variant::DICTIONARY) {
+		Dictionary new_arguments = *p_new_value;
+		for (const Variant *argument = new_arguments.next(nullptr); argument; argument = new_arguments.next(argument)) {
+			_write_flat_slot(flat_state_layout.intern_slot(predicate_id, flat_state_layout.intern_argument(*argument)), new_arguments.getptr(*argument));
 		}
+	} else if (p_new_value) {
+		_write_flat_slot(flat_state_layout.intern_slot(predicate_id, PlannerStateLayout::NO_ARGUMENT), p_new_value);
 	}
+}
 
-	// Compare Arrays properly - need to check if it's an Array and compare elements
-	if (actual_command.get_type() != Variant::ARRAY) {
-		return false;
+void PlannerPlan::_restore_flat_state(int p_node_id, const Dictionary &p_state) {
+	const uint32_t *mark = flat_state_valid ? flat_state_marks.getptr(p_node_id) : nullptr;
+	if (!mark || *mark > flat_state_trail.size()) {
+		// The node was first visited before the last rebuild, e.g. by an adopted parallel worker
+		_rebuild_flat_state(p_state);
+		flat_state_marks.insert(p_node_id, 0);
+		return;
 	}
+	while (flat_state_trail.size() > *mark) {
+		const FlatStateChange &change = flat_state_trail[flat_state_trail.size() - 1];
+		if (change.had_value) {
+			flat_state.set_value(change.slot, change.old_value);
+		} else {
+			flat_state.clear_value(change.slot);
+		}
+		flat_state_trail.resize(flat_state_trail.size() - 1);
+	}
+}
 
-	Array action_arr = actual_command;
+const LocalVector<PlannerFlatState::Goal> &PlannerPlan::_get_flat_goals(int p_goal_node_id, const Variant &p_goal) {
+	LocalVector<PlannerFlatState::Goal> *goals = flat_goals.getptr(p_goal_node_id);
+	if (goals) {
+		return *goals;
+	}
+	LocalVector<PlannerFlatState::Goal> compiled;
+	if (p_goal.get_type() == Variant::ARRAY) {
+		// Same String keys as the Dictionary check of a unigoal
+		Array goal_arr = p_goal;
+		compiled.push_back(PlannerFlatState::compile_goal(&flat_state_layout, String(goal_arr[0]), String(goal_arr[1]), goal_arr[2]));
+	} else {
+		compiled = PlannerFlatState::compile_multigoal(&flat_state_layout, p_goal);
+	}
+	return flat_goals.insert(p_goal_node_id, compiled)->value;
+}
 
-	// Check each blacklisted command
-	for (int i = 0; i < blacklisted_commands.size(); i++) {
-		Variant blacklisted = blacklisted_commands[i];
-		if (blacklisted.get_type() != Variant::ARRAY) {
-			continue;
+void PlannerPlan::_backtrack(PlanningCursor &r_cursor, int p_node_id) {
+	// A speculative worker stops once backtracking climbs past its pinned choice point;
+	// the parent search then moves on to the next method
+	bool through_pinned_node = speculative_node_id >= 0 && _is_ancestor_or_self(speculative_node_id, p_node_id);
+
+	// Remember every refinement this backtrack fails. Temporal failures depend on the
+	// constraints gathered along the path, so searches that use the STN are not recorded.
+	if (!nogoods.is_empty() && stn.get_time_point_count() <= 1) {
+		_record_nogood(p_node_id);
+		for (int node_id = r_cursor.parent_node_id; node_id >= 0 && !PlannerBacktracking::can_retry(solution_graph, node_id); node_id = solution_graph.get_parent(node_id)) {
+			_record_nogood(node_id);
 		}
+	}
 
-		Array blacklisted_arr = blacklisted;
+	PlannerBacktracking::BacktrackResult backtrack_result = PlannerBacktracking::backtrack(solution_graph, r_cursor.parent_node_id, p_node_id);
+	if (through_pinned_node && (!solution_graph.has_node(speculative_node_id) || solution_graph.get_node_status(speculative_node_id) == PlannerNodeStatus::STATUS_FAILED)) {
+		speculative_node_exhausted = true;
+		r_cursor.finish(PLAN_STATUS_FAILED);
+		return;
+	}
+	if (backtrack_result.parent_node_id >= 0) {
+		// The reopened node restores its state and STN snapshots when it is revisited
+		r_cursor.advance(backtrack_result.parent_node_id);
+		return;
+	}
+	r_cursor.finish(PLAN_STATUS_FAILED);
+}
 
-		// Compare Arrays element by element
-		if (blacklisted_arr.size() != action_arr.size()) {
-			continue;
+uint64_t PlannerPlan::_nogood_key(int p_node_id) const {
+	// Depth is part of the key because max_depth can fail a refinement that would succeed higher up
+	uint64_t key = PlannerStateHash::combine(solution_graph.get_state_hash(p_node_id), solution_graph.get_node_info(p_node_id).hash());
+	key = PlannerStateHash::combine(key, solution_graph.get_node_depth(p_node_id));
+	return key != 0 ? key : 1;
+}
+
+bool PlannerPlan::_is_nogood(int p_node_id) const {
+	uint64_t key = _nogood_key(p_node_id);
+	return nogoods[key % nogoods.size()] == key;
+}
+
+void PlannerPlan::_record_nogood(int p_node_id) {
+	PlannerNodeType node_type = solution_graph.get_node_type(p_node_id);
+	if (node_type != PlannerNodeType::TYPE_TASK && node_type != PlannerNodeType::TYPE_GOAL && node_type != PlannerNodeType::TYPE_MULTIGOAL) {
+		return;
+	}
+	// Nodes failed before their first visit have no state hash
+	if (!solution_graph.has_snapshot(p_node_id)) {
+		return;
+	}
+	// A speculative worker only tries one method of its pinned node, so that node and
+	// its ancestors have not really failed
+	if (speculative_node_id >= 0 && _is_ancestor_or_self(p_node_id, speculative_node_id)) {
+		return;
+	}
+	uint64_t key = _nogood_key(p_node_id);
+	nogoods[key % nogoods.size()] = key;
+}
+
+bool PlannerPlan::_is_ancestor_or_self(int p_ancestor_id, int p_node_id) const {
+	for (int node_id = p_node_id; node_id >= 0; node_id = solution_graph.get_parent(node_id)) {
+		if (node_id == p_ancestor_id) {
+			return true;
 		}
+	}
+	return false;
+}
 
-		bool match = true;
-		for (int j = 0; j < action_arr.size(); j++) {
-			if (action_arr[j] != blacklisted_arr[j]) {
-				match = false;
-				break;
+bool PlannerPlan::_should_refine_in_parallel(int p_node_id, int p_first_method_index) const {
+	// Nodes near the root have the largest subtrees, so depth stands in for the subtree estimate
+	if (parallel_method_depth <= 0 || speculative_node_id >= 0) {
+		return false;
+	}
+	if (solution_graph.get_node_depth(p_node_id) > parallel_method_depth) {
+		return false;
+	}
+	return solution_graph.get_available_methods(p_node_id).size() - p_first_method_index >= 2;
+}
+
+void PlannerPlan::_refine_in_parallel(PlanningCursor &r_cursor, int p_node_id, int p_first_method_index) {
+	// Copy, the graph is replaced below when a worker's result is adopted
+	const TypedArray<Callable> available_methods = solution_graph.get_available_methods(p_node_id);
+	int method_count = available_methods.size() - p_first_method_index;
+
+	// Workers call the domain's Callables concurrently, so they share one snapshot rather than the live domain
+	if (parallel_domain.is_null()) {
+		parallel_domain = current_domain->create_snapshot();
+	}
+
+	SpeculativeRefinementJob job;
+	job.owner = this;
+	job.node_id = p_node_id;
+	job.decided_index.store(method_count);
+	job.expansions.store(r_cursor.expansions);
+	job.workers.resize(method_count);
+	job.cursors.resize(method_count);
+	for (int i = 0; i < method_count; i++) {
+		job.methods.push_back(available_methods[p_first_method_index + i]);
+		job.workers[i] = _create_worker(parallel_domain);
+		job.workers[i]->shared_expansions = &job.expansions;
+		// The workers clone the graph and STN themselves; the state is copied only when written
+		job.cursors[i] = r_cursor;
+		job.cursors[i].state_shared = true;
+	}
+
+	if (verbose >= 2) {
+		print_line(vformat("Refining node %d with %d methods in parallel", p_node_id, method_count));
+	}
+	WorkerThreadPool::GroupID group_id = WorkerThreadPool::get_singleton()->add_template_group_task(this, &PlannerPlan::_speculative_refinement_task, &job, method_count, -1, true, "PlannerPlan::_refine_in_parallel");
+	WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group_id);
+
+	int nogood_hits = r_cursor.nogood_hits;
+	int nogood_misses = r_cursor.nogood_misses;
+	for (int i = 0; i < method_count; i++) {
+		nogood_hits += job.cursors[i].nogood_hits - r_cursor.nogood_hits;
+		nogood_misses += job.cursors[i].nogood_misses - r_cursor.nogood_misses;
+	}
+
+	int adopted_index = -1;
+	for (int i = 0; i < method_count; i++) {
+		if (!job.workers[i]->speculative_node_exhausted) {
+			adopted_index = i;
+			break;
+		}
+	}
+
+	// The sequential search would have kept what the methods before the adopted one blacklisted
+	// and recorded, so merge the workers up to it in method order; nogood slots keep the last write
+	const int merged_count = adopted_index >= 0 ? adopted_index + 1 : method_count;
+	const int base_blacklist_size = blacklisted_commands.size();
+	const LocalVector<uint64_t> base_nogoods = nogoods;
+	for (int i = 0; i < merged_count; i++) {
+		const PlannerPlan *worker = job.workers[i].ptr();
+		for (int j = base_blacklist_size; j < worker->blacklisted_commands.size(); j++) {
+			_blacklist_command(worker->blacklisted_commands[j]);
+		}
+		for (uint32_t slot = 0; slot < nogoods.size() && slot < worker->nogoods.size(); slot++) {
+			if (worker->nogoods[slot] != base_nogoods[slot]) {
+				nogoods[slot] = worker->nogoods[slot];
 			}
 		}
+	}
 
-		if (match) {
-			return true;
+	if (adopted_index >= 0) {
+		Ref<PlannerPlan> worker = job.workers[adopted_index];
+		solution_graph = worker->solution_graph;
+		solution_graph.set_available_methods(p_node_id, available_methods);
+		if (solution_graph.has_node(p_node_id)) {
+			// The worker only knew the pinned method, at index 0; methods before it are exhausted
+			solution_graph.set_selected_method_index(p_node_id, p_first_method_index + adopted_index + solution_graph.get_selected_method_index(p_node_id));
 		}
+		stn = worker->stn;
+		r_cursor = job.cursors[adopted_index];
+		// The worker's state replaces ours, so the flat state and its node marks are stale
+		flat_state_valid = false;
+		r_cursor.expansions = job.expansions.load();
+		r_cursor.nogood_hits = nogood_hits;
+		r_cursor.nogood_misses = nogood_misses;
+		return;
 	}
-	return false;
+
+	// Every remaining method failed: the choice point is exhausted, backtrack past it
+	r_cursor.expansions = job.expansions.load();
+	r_cursor.nogood_hits = nogood_hits;
+	r_cursor.nogood_misses = nogood_misses;
+	solution_graph.set_selected_method_index(p_node_id, available_methods.size() - 1);
+	_backtrack(r_cursor, p_node_id);
+}
+
+void PlannerPlan::_speculative_refinement_task(uint32_t p_index, SpeculativeRefinementJob *p_job) {
+	// An earlier method has already settled the search, this result would be discarded
+	if (p_job->decided_index.load() < int(p_index)) {
+		return;
+	}
+
+	// Clone here rather than in _refine_in_parallel so that the copies run in parallel too
+	PlannerPlan *worker = p_job->workers[p_index].ptr();
+	const PlannerPlan *owner = p_job->owner;
+	worker->solution_graph = owner->solution_graph;
+	worker->stn = owner->stn;
+	worker->blacklisted_commands = owner->blacklisted_commands.duplicate();
+	worker->blacklisted_command_set = owner->blacklisted_command_set;
+	worker->nogoods = owner->nogoods;
+
+	const TypedArray<Callable> &methods = p_job->methods;
+	TypedArray<Callable> pinned_method;
+	pinned_method.push_back(methods[p_index]);
+	worker->solution_graph.set_available_methods(p_job->node_id, pinned_method);
+	worker->solution_graph.set_selected_method_index(p_job->node_id, -1);
+	worker->speculative_node_id = p_job->node_id;
+
+	PlanningCursor &cursor = p_job->cursors[p_index];
+	if (worker->use_state_trail) {
+		// Undoing the trail writes to the state in place
+		cursor.unshare_state();
+	}
+	while (!cursor.done) {
+		if (p_job->decided_index.load() < int(p_index)) {
+			return;
+		}
+		worker->_run_planning_steps(cursor, 64, 0);
+	}
+	if (worker->speculative_node_exhausted) {
+		return;
+	}
+	int decided_index = p_job->decided_index.load();
+	while (int(p_index) < decided_index && !p_job->decided_index.compare_exchange_weak(decided_index, p_index)) {
+	}
+}
+
+Variant PlannerPlan::_unwrap_command(const Variant &p_command) {
+	if (p_command.get_type() == Variant::DICTIONARY) {
+		Dictionary dict = p_command;
+		if (dict.has("item")) {
+			return dict["item"];
+		}
+	}
+	return p_command;
+}
+
+bool PlannerPlan::_is_command_blacklisted(Variant p_command) const {
+	Variant actual_command = _unwrap_command(p_command);
+	if (actual_command.get_type() != Variant::ARRAY) {
+		return false;
+	}
+	// Arrays hash and compare by their elements, so this matches the command tuple
+	return blacklisted_command_set.has(actual_command);
 }
 
 void PlannerPlan::_blacklist_command(Variant p_command) {
-	if (!_is_command_blacklisted(p_command)) {
-		blacklisted_commands.push_back(p_command);
+	Variant actual_command = _unwrap_command(p_command);
+	if (actual_command.get_type() != Variant::ARRAY || blacklisted_command_set.has(actual_command)) {
+		return;
 	}
+	// Own copy so that later edits to the item cannot change its hash
+	blacklisted_command_set.insert(Array(actual_command).duplicate(true));
+	blacklisted_commands.push_back(p_command);
 }
 
 // Goal solver methods (moved from PlannerGoalSolver)
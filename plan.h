@@ -35,28 +35,48 @@
 // Author: Dana Nau <nau@umd.edu>, July 7, 2021
 
 #include "core/io/resource.h"
+#include "core/object/worker_thread_pool.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/templates/local_vector.h"
+#include "core/templates/lru.h"
 #include "core/variant/typed_array.h"
 
 #include "modules/goal_task_planner/multigoal.h"
+#include "modules/goal_task_planner/planner_flat_state.h"
 #include "modules/goal_task_planner/planner_metadata.h"
 #include "modules/goal_task_planner/planner_time_range.h"
 #include "modules/goal_task_planner/solution_graph.h"
 #include "modules/goal_task_planner/stn_solver.h"
 
+#include <atomic>
+
 class PlannerDomain;
 struct PlannerTimeRange;
 
 class PlannerPlan : public Resource {
 	GDCLASS(PlannerPlan, Resource);
+	friend class PlannerSession;
+
+public:
+	// Outcome of the last find_plan() or run_lazy_refineahead() call
+	enum PlanStatus {
+		PLAN_STATUS_NONE,
+		PLAN_STATUS_SUCCEEDED,
+		PLAN_STATUS_FAILED,
+		PLAN_STATUS_EXPANSION_BUDGET_EXHAUSTED,
+		PLAN_STATUS_TIME_BUDGET_EXHAUSTED,
+	};
 
+private:
 	int verbose = 0;
 	TypedArray<PlannerDomain> domains;
 	Ref<PlannerDomain> current_domain;
 	PlannerTimeRange time_range; // Added for temporal
 	PlannerSolutionGraph solution_graph; // Solution graph for explicit backtracking
-	TypedArray<Variant> blacklisted_commands; // Blacklisted commands/actions
+	TypedArray<Variant> blacklisted_commands; // Blacklisted commands/actions, in the order they failed
+	HashSet<Variant, VariantHasher, StringLikeVariantComparator> blacklisted_command_set; // Same commands unwrapped, hashed by structure
 	PlannerSTNSolver stn; // STN solver for temporal constraint validation
-	PlannerSTNSolver::Snapshot stn_snapshot; // STN snapshot for backtracking
 
 	// If verify_goals is True, then whenever the planner uses a method m to refine
 	// unigoal or multigoal, it will insert a "verification" task into the
@@ -68,14 +88,160 @@ class PlannerPlan : public Resource {
 	// supposed to achieve. The verification task won't insert anything into the
 	// final plan; it just will verify whether m did what it was supposed to do.
 	bool verify_goals = true;
-	int max_depth = 10; // Maximum recursion depth to prevent infinite loops
+	int max_depth = 1000; // Maximum decomposition depth below the root, 0 for no limit
+	int max_expansions = 0; // Maximum node expansions per call, 0 for no limit
+	int64_t time_budget_usec = 0; // Wall-clock budget per call in microseconds, 0 for no limit
+	int parallel_method_depth = 0; // Choice points at or above this depth try their methods in parallel, 0 disables
+	bool use_state_trail = false; // Undo action changes on backtracking instead of keeping a state per node
+	bool use_persistent_state = false; // Keep node states as structurally shared versions; ignored in trail mode
+	int nogood_cache_size = 4096; // Slots for failed refinements remembered per call, 0 disables
+	// Direct-mapped table of failed (item, state hash, depth) keys; 0 marks an empty slot
+	// and a colliding failure overwrites the older one
+	LocalVector<uint64_t> nogoods;
+	HashMap<uint64_t, Variant> method_memo; // Results of pure task methods by method, task and state hash
+
+	// Compiled domains check goals against a flat copy of the cursor's state. Actions
+	// update it in the same walk as the state hash, and revisiting a node undoes it to
+	// that node's mark. Like the hash, it does not see methods writing to their state.
+	struct FlatStateChange {
+		int slot = -1;
+		Variant old_value;
+		bool had_value = false;
+	};
+	bool use_flat_state = false;
+	bool flat_state_valid = false; // False until rebuilt from the cursor's state
+	PlannerStateLayout flat_state_layout;
+	PlannerFlatState flat_state;
+	LocalVector<FlatStateChange> flat_state_trail;
+	HashMap<int, uint32_t> flat_state_marks; // Trail size at each node's first visit
+	HashMap<int, LocalVector<PlannerFlatState::Goal>> flat_goals; // Compiled goals of goal and multigoal nodes
+
+	// Plans found by earlier find_plan() calls, keyed by a hash of the todo list, the
+	// state and the search settings. A hit must also match the stored state and todo list.
+	struct CachedPlan {
+		Dictionary state;
+		Array todo_list;
+		Array plan;
+	};
+	int plan_cache_size = 0; // 0 disables the cache
+	LRUCache<uint64_t, CachedPlan> plan_cache;
+	int plan_cache_hit_count = 0;
+	int plan_cache_miss_count = 0;
+	PlanStatus last_plan_status = PLAN_STATUS_NONE;
+	int last_expansion_count = 0;
+	int last_nogood_hit_count = 0;
+	int last_nogood_miss_count = 0;
 	static String _item_to_string(Variant p_item);
 	Variant _apply_task_and_continue(Dictionary p_state, Callable p_command, Array p_arguments);
 	// Graph-based planning methods
-	Dictionary _planning_loop_recursive(int p_parent_node_id, Dictionary p_state, int p_iter);
+	// Cursor of the iterative planning loop: the node whose open children are refined next,
+	// the state at that point and the number of steps taken so far
+	struct PlanningCursor {
+		int parent_node_id = 0;
+		Dictionary state;
+		uint64_t state_hash = 0; // PlannerStateHash of state, kept up to date by each action
+		bool state_shared = false; // A node snapshot holds state itself, so it is copied before a method may write to it
+		PlannerPersistentState persistent_state; // Version of state for node snapshots, kept up to date by each action
+		int iteration = 0;
+		int expansions = 0;
+		int nogood_hits = 0;
+		int nogood_misses = 0;
+		uint64_t deadline_usec = 0; // 0 when there is no time budget
+		PlanStatus status = PLAN_STATUS_NONE;
+		bool done = false;
+
+		void unshare_state() {
+			if (state_shared) {
+				state = state.duplicate();
+				state_shared = false;
+			}
+		}
+		void advance(int p_parent_node_id) {
+			parent_node_id = p_parent_node_id;
+			iteration++;
+		}
+		void finish(PlanStatus p_status) {
+			status = p_status;
+			done = true;
+		}
+	};
+	void _begin_planning(const Dictionary &p_state, const Array &p_todo_list, PlanningCursor &r_cursor);
+	bool _run_planning_steps(PlanningCursor &r_cursor, int p_max_expansions, uint64_t p_max_usec);
+	Variant _finish_plan(const Dictionary &p_final_state);
+	void _planning_step(PlanningCursor &r_cursor);
+	static Variant _unwrap_command(const Variant &p_command);
 	bool _is_command_blacklisted(Variant p_command) const;
 	void _blacklist_command(Variant p_command);
 	void _restore_stn_from_node(int p_node_id);
+	uint64_t _nogood_key(int p_node_id) const;
+	bool _is_nogood(int p_node_id) const;
+	void _record_nogood(int p_node_id);
+	int _add_child_nodes(int p_parent_node_id, const Array &p_items);
+	// Calls an action or method with the state followed by the arguments of p_item,
+	// directly when the domain registered it natively
+	Variant _call_with_item(const Callable &p_callable, const Dictionary &p_state, const Array &p_item) const;
+	void _rebuild_flat_state(const Dictionary &p_state);
+	void _write_flat_slot(int p_slot, const Variant *p_value);
+	void _record_flat_state_change(const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value);
+	void _restore_flat_state(int p_node_id, const Dictionary &p_state);
+	const LocalVector<PlannerFlatState::Goal> &_get_flat_goals(int p_goal_node_id, const Variant &p_goal);
+	uint64_t _plan_cache_key(const Dictionary &p_state, const Array &p_todo_list) const;
+
+	// Background planning. Each job searches on a private worker plan that holds a
+	// snapshot of the domain, so this plan's solution graph and STN are never
+	// touched from another thread. Jobs are only added and removed on the caller's thread.
+	struct AsyncPlanJob {
+		int64_t id = 0;
+		Ref<PlannerPlan> owner; // Keeps this plan alive until the result is delivered
+		Ref<PlannerPlan> worker;
+		Dictionary state;
+		Array todo_list;
+		Variant result;
+		PlanStatus status = PLAN_STATUS_NONE;
+		WorkerThreadPool::TaskID task_id = WorkerThreadPool::INVALID_TASK_ID;
+	};
+	HashMap<int64_t, AsyncPlanJob *> async_jobs;
+	int64_t next_async_plan_id = 1;
+
+	// Batch planning (find_plans). All problems share one domain snapshot; each
+	// gets its own worker plan, and with it its own solution graph and STN.
+	struct BatchPlanJob {
+		Ref<PlannerDomain> domain;
+		Array states;
+		Array todo_lists;
+		LocalVector<Variant> results;
+	};
+
+	Ref<PlannerPlan> _create_worker(const Ref<PlannerDomain> &p_domain) const;
+	void _async_plan_task(AsyncPlanJob *p_job);
+	void _batch_plan_task(uint32_t p_index, BatchPlanJob *p_job);
+
+	// OR-parallel refinement. Each remaining method of a choice point gets a worker
+	// plan on a snapshot of the domain that clones the graph and STN, pins the choice
+	// point to that one method and runs the rest of the search. The first worker in
+	// method order that does not exhaust its pinned choice point decides the outcome;
+	// the blacklists and nogoods of the workers before it are merged in method order.
+	struct SpeculativeRefinementJob {
+		const PlannerPlan *owner = nullptr; // Blocked until the workers finish, read-only meanwhile
+		int node_id = -1;
+		TypedArray<Callable> methods; // One per worker, in method order
+		LocalVector<Ref<PlannerPlan>> workers;
+		LocalVector<PlanningCursor> cursors;
+		std::atomic<int> decided_index; // Lowest method whose worker settled the search
+		std::atomic<int> expansions; // Shared by the workers so max_expansions bounds their total
+	};
+	int speculative_node_id = -1; // Pinned choice point when this plan is a speculative worker
+	bool speculative_node_exhausted = false;
+	std::atomic<int> *shared_expansions = nullptr; // Expansion counter of the speculative job this worker runs in
+	Ref<PlannerDomain> parallel_domain; // Snapshot of current_domain for speculative workers, taken once per search
+
+	bool _should_refine_in_parallel(int p_node_id, int p_first_method_index) const;
+	void _refine_in_parallel(PlanningCursor &r_cursor, int p_node_id, int p_first_method_index);
+	void _speculative_refinement_task(uint32_t p_index, SpeculativeRefinementJob *p_job);
+	bool _is_ancestor_or_self(int p_ancestor_id, int p_node_id) const;
+	void _async_plan_completed(int64_t p_task_id);
+	Variant _deliver_async_plan(int64_t p_task_id);
+	void _backtrack(PlanningCursor &r_cursor, int p_node_id);
 
 	// Goal solver methods (moved from PlannerGoalSolver)
 	// Constraining factor for a goal/task - two optimization strategies:
@@ -131,12 +297,40 @@ public:
 	TypedArray<PlannerDomain> get_domains() const;
 	void set_domains(TypedArray<PlannerDomain> p_domain);
 	Ref<PlannerDomain> get_current_domain() const;
-	void set_current_domain(Ref<PlannerDomain> p_current_domain) { current_domain = p_current_domain; }
+	void set_current_domain(Ref<PlannerDomain> p_current_domain);
 	void set_verify_goals(bool p_value);
 	bool get_verify_goals() const;
 	void set_max_depth(int p_max_depth);
 	int get_max_depth() const;
+	void set_max_expansions(int p_max_expansions);
+	int get_max_expansions() const;
+	void set_parallel_method_depth(int p_depth);
+	int get_parallel_method_depth() const;
+	void set_use_state_trail(bool p_enabled);
+	bool get_use_state_trail() const;
+	void set_use_persistent_state(bool p_enabled);
+	bool get_use_persistent_state() const;
+	void set_nogood_cache_size(int p_size);
+	int get_nogood_cache_size() const;
+	void set_plan_cache_size(int p_size);
+	int get_plan_cache_size() const;
+	void clear_plan_cache();
+	int get_plan_cache_hit_count() const;
+	int get_plan_cache_miss_count() const;
+	void set_time_budget_usec(int64_t p_time_budget_usec);
+	int64_t get_time_budget_usec() const;
+	int64_t get_state_hash(const Dictionary &p_state) const;
+	PlanStatus get_last_plan_status() const;
+	int get_last_expansion_count() const;
+	TypedArray<Variant> get_blacklisted_commands() const;
+	int get_blacklisted_command_count() const;
+	int get_last_nogood_hit_count() const;
+	int get_last_nogood_miss_count() const;
 	Variant find_plan(Dictionary p_state, Array p_todo_list);
+	int64_t find_plan_async(Dictionary p_state, Array p_todo_list);
+	bool is_async_plan_completed(int64_t p_task_id) const;
+	Variant wait_for_async_plan(int64_t p_task_id);
+	Array find_plans(Array p_states, Array p_todo_lists);
 	Dictionary run_lazy_lookahead(Dictionary p_state, Array p_todo_list, int p_max_tries = 10);
 	// Graph-based lazy refinement (Elixir-style)
 	Dictionary run_lazy_refineahead(Dictionary p_state, Array p_todo_list);
@@ -146,7 +340,10 @@ public:
 	void set_time_range(PlannerTimeRange p_time_range) { time_range = p_time_range; }
 	Dictionary submit_operation(Dictionary p_operation);
 	Dictionary get_global_state();
+	Dictionary get_solution_graph() const;
 
 protected:
 	static void _bind_methods();
 };
+
+VARIANT_ENUM_CAST(PlannerPlan::PlanStatus);
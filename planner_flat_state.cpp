@@ -0,0 +1,423 @@
+/**************************************************************************/
+/*  planner_flat_state.cpp                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "planner_flat_state.h"
+
+#include "core/error/error_macros.h"
+
+int PlannerStateLayout::intern_predicate(const Variant &p_predicate) {
+	const int *existing = predicate_ids.getptr(p_predicate);
+	if (existing) {
+		return *existing;
+	}
+	int id = predicates.size();
+	predicates.push_back(p_predicate);
+	predicate_ids.insert(p_predicate, id);
+	return id;
+}
+
+int PlannerStateLayout::intern_argument(const Variant &p_argument) {
+	const int *existing = argument_ids.getptr(p_argument);
+	if (existing) {
+		return *existing;
+	}
+	int id = arguments.size();
+	arguments.push_back(p_argument);
+	argument_ids.insert(p_argument, id);
+	return id;
+}
+
+int PlannerStateLayout::intern_string(const String &p_string) {
+	const int *existing = string_ids.getptr(p_string);
+	if (existing) {
+		return *existing;
+	}
+	int id = strings.size();
+	strings.push_back(p_string);
+	string_ids.insert(p_string, id);
+	return id;
+}
+
+int PlannerStateLayout::intern_slot(int p_predicate_id, int p_argument_id) {
+	uint64_t key = _slot_key(p_predicate_id, p_argument_id);
+	const int *existing = slot_ids.getptr(key);
+	if (existing) {
+		return *existing;
+	}
+	int slot = slot_predicates.size();
+	slot_predicates.push_back(p_predicate_id);
+	slot_arguments.push_back(p_argument_id);
+	slot_ids.insert(key, slot);
+	return slot;
+}
+
+int PlannerStateLayout::intern_slot(const Variant &p_predicate, const Variant &p_argument) {
+	return intern_slot(intern_predicate(p_predicate), intern_argument(p_argument));
+}
+
+int PlannerStateLayout::find_predicate(const Variant &p_predicate) const {
+	const int *existing = predicate_ids.getptr(p_predicate);
+	return existing ? *existing : -1;
+}
+
+int PlannerStateLayout::find_argument(const Variant &p_argument) const {
+	const int *existing = argument_ids.getptr(p_argument);
+	return existing ? *existing : -1;
+}
+
+int PlannerStateLayout::find_slot(int p_predicate_id, int p_argument_id) const {
+	if (p_predicate_id < 0) {
+		return -1;
+	}
+	const int *existing = slot_ids.getptr(_slot_key(p_predicate_id, p_argument_id));
+	return existing ? *existing : -1;
+}
+
+PlannerFlatState::Value PlannerFlatState::_encode(const Variant &p_value, int64_t p_variant_index) {
+	Value value;
+	switch (p_value.get_type()) {
+		case Variant::BOOL:
+			value.type = SLOT_BOOL;
+			value.integer = bool(p_value) ? 1 : 0;
+			break;
+		case Variant::INT:
+			value.type = SLOT_INT;
+			value.integer = p_value;
+			break;
+		case Variant::FLOAT:
+			value.type = SLOT_FLOAT;
+			value.real = p_value;
+			break;
+		case Variant::STRING:
+		case Variant::STRING_NAME:
+			value.type = SLOT_STRING;
+			value.integer = layout->intern_string(p_value);
+			break;
+		default:
+			value.type = SLOT_VARIANT;
+			if (p_variant_index >= 0) {
+				value.integer = p_variant_index;
+				variant_values[p_variant_index] = p_value;
+			} else {
+				value.integer = variant_values.size();
+				variant_values.push_back(p_value);
+			}
+			break;
+	}
+	return value;
+}
+
+bool PlannerFlatState::_values_equal(const Value &p_a, const Value &p_b) {
+	if (p_a.type == p_b.type) {
+		if (p_a.type == SLOT_FLOAT) {
+			return p_a.real == p_b.real;
+		}
+		return p_a.integer == p_b.integer;
+	}
+	// Match Variant equality between ints and floats
+	if (p_a.type == SLOT_INT && p_b.type == SLOT_FLOAT) {
+		return double(p_a.integer) == p_b.real;
+	}
+	if (p_a.type == SLOT_FLOAT && p_b.type == SLOT_INT) {
+		return p_a.real == double(p_b.integer);
+	}
+	return false;
+}
+
+void PlannerFlatState::_mark_dictionary_predicate(int p_predicate_id) {
+	if (p_predicate_id >= (int)dictionary_predicates.size()) {
+		uint32_t old_size = dictionary_predicates.size();
+		dictionary_predicates.resize(p_predicate_id + 1);
+		for (uint32_t i = old_size; i < dictionary_predicates.size(); i++) {
+			dictionary_predicates[i] = 0;
+		}
+	}
+	dictionary_predicates[p_predicate_id] = 1;
+}
+
+void PlannerFlatState::_prepare_slot(int p_slot) {
+	if (p_slot >= (int)values.size()) {
+		values.resize(p_slot + 1);
+	}
+	if (layout->get_slot_argument(p_slot) != PlannerStateLayout::NO_ARGUMENT) {
+		_mark_dictionary_predicate(layout->get_slot_predicate(p_slot));
+	}
+}
+
+PlannerFlatState PlannerFlatState::from_dictionary(PlannerStateLayout *p_layout, const Dictionary &p_state) {
+	ERR_FAIL_NULL_V(p_layout, PlannerFlatState());
+	PlannerFlatState flat(p_layout);
+	Array variables = p_state.keys();
+	for (int i = 0; i < variables.size(); i++) {
+		const Variant &variable = variables[i];
+		int predicate_id = p_layout->intern_predicate(variable);
+		Variant variable_value = p_state[variable];
+		if (variable_value.get_type() != Variant::DICTIONARY) {
+			flat.set_value(p_layout->intern_slot(predicate_id, PlannerStateLayout::NO_ARGUMENT), variable_value);
+			continue;
+		}
+		// Mark it even when empty so the variable survives the round trip
+		flat._mark_dictionary_predicate(predicate_id);
+		Dictionary variable_arguments = variable_value;
+		Array argument_keys = variable_arguments.keys();
+		for (int j = 0; j < argument_keys.size(); j++) {
+			int slot = p_layout->intern_slot(predicate_id, p_layout->intern_argument(argument_keys[j]));
+			flat.set_value(slot, variable_arguments[argument_keys[j]]);
+		}
+	}
+	return flat;
+}
+
+Dictionary PlannerFlatState::to_dictionary() const {
+	Dictionary state;
+	ERR_FAIL_NULL_V(layout, state);
+	LocalVector<Dictionary> variables;
+	variables.resize(dictionary_predicates.size());
+	for (uint32_t predicate_id = 0; predicate_id < dictionary_predicates.size(); predicate_id++) {
+		if (dictionary_predicates[predicate_id]) {
+			state[layout->get_predicate(predicate_id)] = variables[predicate_id];
+		}
+	}
+	for (uint32_t slot = 0; slot < values.size(); slot++) {
+		if (values[slot].type == SLOT_EMPTY) {
+			continue;
+		}
+		int predicate_id = layout->get_slot_predicate(slot);
+		int argument_id = layout->get_slot_argument(slot);
+		if (argument_id == PlannerStateLayout::NO_ARGUMENT) {
+			state[layout->get_predicate(predicate_id)] = get_value(slot);
+		} else {
+			variables[predicate_id][layout->get_argument(argument_id)] = get_value(slot);
+		}
+	}
+	return state;
+}
+
+PlannerFlatState PlannerFlatState::from_planner_state(PlannerStateLayout *p_layout, const Ref<PlannerState> &p_state) {
+	ERR_FAIL_NULL_V(p_layout, PlannerFlatState());
+	ERR_FAIL_COND_V(p_state.is_null(), PlannerFlatState(p_layout));
+	PlannerFlatState flat(p_layout);
+	Array subjects = p_state->data.keys();
+	for (int i = 0; i < subjects.size(); i++) {
+		int argument_id = p_layout->intern_argument(subjects[i]);
+		Dictionary subject_data = p_state->data[subjects[i]];
+		Array subject_predicates = subject_data.keys();
+		for (int j = 0; j < subject_predicates.size(); j++) {
+			int slot = p_layout->intern_slot(p_layout->intern_predicate(subject_predicates[j]), argument_id);
+			flat.set_value(slot, subject_data[subject_predicates[j]]);
+		}
+	}
+	Array entities = p_state->entity_capabilities.keys();
+	for (int i = 0; i < entities.size(); i++) {
+		int slot = p_layout->intern_slot("entity_capabilities", entities[i]);
+		flat.set_value(slot, p_state->entity_capabilities[entities[i]]);
+	}
+	return flat;
+}
+
+Ref<PlannerState> PlannerFlatState::to_planner_state() const {
+	Ref<PlannerState> planner_state;
+	planner_state.instantiate();
+	ERR_FAIL_NULL_V(layout, planner_state);
+	int entity_capabilities_id = layout->find_predicate("entity_capabilities");
+	for (uint32_t slot = 0; slot < values.size(); slot++) {
+		const Value &value = values[slot];
+		int argument_id = layout->get_slot_argument(slot);
+		if (value.type == SLOT_EMPTY || argument_id == PlannerStateLayout::NO_ARGUMENT) {
+			continue;
+		}
+		int predicate_id = layout->get_slot_predicate(slot);
+		String subject = layout->get_argument(argument_id);
+		if (predicate_id == entity_capabilities_id) {
+			if (value.type != SLOT_VARIANT || variant_values[value.integer].get_type() != Variant::DICTIONARY) {
+				continue;
+			}
+			Dictionary capabilities = variant_values[value.integer];
+			Array capability_keys = capabilities.keys();
+			for (int i = 0; i < capability_keys.size(); i++) {
+				planner_state->set_entity_capability(subject, capability_keys[i], capabilities[capability_keys[i]]);
+			}
+		} else if (value.type != SLOT_VARIANT) {
+			planner_state->set_predicate(subject, layout->get_predicate(predicate_id), get_value(slot));
+		}
+	}
+	return planner_state;
+}
+
+Variant PlannerFlatState::get_value(int p_slot) const {
+	if (!has_value(p_slot)) {
+		return Variant();
+	}
+	const Value &value = values[p_slot];
+	switch (value.type) {
+		case SLOT_BOOL:
+			return value.integer != 0;
+		case SLOT_INT:
+			return value.integer;
+		case SLOT_FLOAT:
+			return value.real;
+		case SLOT_STRING:
+			return layout->get_string(value.integer);
+		case SLOT_VARIANT:
+			return variant_values[value.integer];
+		default:
+			return Variant();
+	}
+}
+
+void PlannerFlatState::set_value(int p_slot, const Variant &p_value) {
+	ERR_FAIL_NULL(layout);
+	ERR_FAIL_INDEX(p_slot, layout->get_slot_count());
+	_prepare_slot(p_slot);
+	// Reuse the slot's variant entry rather than growing the table on every write
+	int64_t variant_index = values[p_slot].type == SLOT_VARIANT ? values[p_slot].integer : -1;
+	values[p_slot] = _encode(p_value, variant_index);
+}
+
+void PlannerFlatState::clear_value(int p_slot) {
+	if (has_value(p_slot)) {
+		values[p_slot] = Value();
+	}
+}
+
+bool PlannerFlatState::get_bool(int p_slot, bool p_default) const {
+	return get_slot_type(p_slot) == SLOT_BOOL ? values[p_slot].integer != 0 : p_default;
+}
+
+int64_t PlannerFlatState::get_int(int p_slot, int64_t p_default) const {
+	return get_slot_type(p_slot) == SLOT_INT ? values[p_slot].integer : p_default;
+}
+
+double PlannerFlatState::get_float(int p_slot, double p_default) const {
+	switch (get_slot_type(p_slot)) {
+		case SLOT_FLOAT:
+			return values[p_slot].real;
+		case SLOT_INT:
+			return double(values[p_slot].integer);
+		default:
+			return p_default;
+	}
+}
+
+int PlannerFlatState::get_string_id(int p_slot) const {
+	return get_slot_type(p_slot) == SLOT_STRING ? int(values[p_slot].integer) : -1;
+}
+
+void PlannerFlatState::set_bool(int p_slot, bool p_value) {
+	ERR_FAIL_NULL(layout);
+	ERR_FAIL_INDEX(p_slot, layout->get_slot_count());
+	_prepare_slot(p_slot);
+	values[p_slot].type = SLOT_BOOL;
+	values[p_slot].integer = p_value ? 1 : 0;
+}
+
+void PlannerFlatState::set_int(int p_slot, int64_t p_value) {
+	ERR_FAIL_NULL(layout);
+	ERR_FAIL_INDEX(p_slot, layout->get_slot_count());
+	_prepare_slot(p_slot);
+	values[p_slot].type = SLOT_INT;
+	values[p_slot].integer = p_value;
+}
+
+void PlannerFlatState::set_float(int p_slot, double p_value) {
+	ERR_FAIL_NULL(layout);
+	ERR_FAIL_INDEX(p_slot, layout->get_slot_count());
+	_prepare_slot(p_slot);
+	values[p_slot].type = SLOT_FLOAT;
+	values[p_slot].real = p_value;
+}
+
+void PlannerFlatState::set_string_id(int p_slot, int p_string_id) {
+	ERR_FAIL_NULL(layout);
+	ERR_FAIL_INDEX(p_slot, layout->get_slot_count());
+	ERR_FAIL_INDEX(p_string_id, layout->get_string_count());
+	_prepare_slot(p_slot);
+	values[p_slot].type = SLOT_STRING;
+	values[p_slot].integer = p_string_id;
+}
+
+PlannerFlatState::Goal PlannerFlatState::compile_goal(PlannerStateLayout *p_layout, const Variant &p_predicate, const Variant &p_argument, const Variant &p_value) {
+	Goal goal;
+	ERR_FAIL_NULL_V(p_layout, goal);
+	goal.slot = p_layout->intern_slot(p_predicate, p_argument);
+	// Encode through a scratch state so goals and states intern values the same way
+	PlannerFlatState scratch(p_layout);
+	goal.value = scratch._encode(p_value);
+	if (goal.value.type == SLOT_VARIANT) {
+		goal.variant = p_value;
+	}
+	return goal;
+}
+
+LocalVector<PlannerFlatState::Goal> PlannerFlatState::compile_multigoal(PlannerStateLayout *p_layout, const Dictionary &p_multigoal) {
+	LocalVector<Goal> goals;
+	Array variables = p_multigoal.keys();
+	for (int i = 0; i < variables.size(); i++) {
+		Variant conditions_value = p_multigoal[variables[i]];
+		if (conditions_value.get_type() != Variant::DICTIONARY) {
+			continue;
+		}
+		Dictionary conditions = conditions_value;
+		Array arguments = conditions.keys();
+		for (int j = 0; j < arguments.size(); j++) {
+			goals.push_back(compile_goal(p_layout, variables[i], arguments[j], conditions[arguments[j]]));
+		}
+	}
+	return goals;
+}
+
+bool PlannerFlatState::is_goal_achieved(const Goal &p_goal) const {
+	if (!has_value(p_goal.slot)) {
+		return false;
+	}
+	const Value &value = values[p_goal.slot];
+	if (p_goal.value.type == SLOT_VARIANT) {
+		return value.type == SLOT_VARIANT && variant_values[value.integer] == p_goal.variant;
+	}
+	return _values_equal(value, p_goal.value);
+}
+
+void PlannerFlatState::get_goals_not_achieved(const LocalVector<Goal> &p_goals, LocalVector<int> &r_unmet) const {
+	r_unmet.clear();
+	for (uint32_t i = 0; i < p_goals.size(); i++) {
+		if (!is_goal_achieved(p_goals[i])) {
+			r_unmet.push_back(i);
+		}
+	}
+}
+
+bool PlannerFlatState::are_goals_achieved(const LocalVector<Goal> &p_goals) const {
+	for (const Goal &goal : p_goals) {
+		if (!is_goal_achieved(goal)) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,165 @@
+/**************************************************************************/
+/*  planner_flat_state.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+// SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
+// SPDX-License-Identifier: MIT
+
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+#include "core/variant/dictionary.h"
+#include "core/variant/variant.h"
+
+#include "planner_state.h"
+
+// Interned ids for state variables (predicates), their arguments and string values.
+// A slot is one (predicate, argument) pair; whole-variable values such as
+// state["initialized"] use NO_ARGUMENT. Ids are only ever appended, so states built
+// against the same layout stay compatible as it grows. Not thread safe while growing.
+class PlannerStateLayout {
+public:
+	static constexpr int NO_ARGUMENT = -1;
+
+private:
+	HashMap<Variant, int, VariantHasher, StringLikeVariantComparator> predicate_ids;
+	LocalVector<Variant> predicates;
+	HashMap<Variant, int, VariantHasher, StringLikeVariantComparator> argument_ids;
+	LocalVector<Variant> arguments;
+	HashMap<String, int> string_ids;
+	LocalVector<String> strings;
+	HashMap<uint64_t, int> slot_ids; // (predicate id << 32) | (argument id + 1)
+	LocalVector<int> slot_predicates;
+	LocalVector<int> slot_arguments;
+
+	_FORCE_INLINE_ static uint64_t _slot_key(int p_predicate_id, int p_argument_id) {
+		return (uint64_t(uint32_t(p_predicate_id)) << 32) | uint32_t(p_argument_id + 1);
+	}
+
+public:
+	int intern_predicate(const Variant &p_predicate);
+	int intern_argument(const Variant &p_argument);
+	int intern_string(const String &p_string);
+	int intern_slot(int p_predicate_id, int p_argument_id);
+	int intern_slot(const Variant &p_predicate, const Variant &p_argument);
+
+	// -1 if the key was never interned
+	int find_predicate(const Variant &p_predicate) const;
+	int find_argument(const Variant &p_argument) const;
+	int find_slot(int p_predicate_id, int p_argument_id) const;
+
+	_FORCE_INLINE_ const Variant &get_predicate(int p_predicate_id) const { return predicates[p_predicate_id]; }
+	_FORCE_INLINE_ const Variant &get_argument(int p_argument_id) const { return arguments[p_argument_id]; }
+	_FORCE_INLINE_ const String &get_string(int p_string_id) const { return strings[p_string_id]; }
+	_FORCE_INLINE_ int get_slot_predicate(int p_slot) const { return slot_predicates[p_slot]; }
+	_FORCE_INLINE_ int get_slot_argument(int p_slot) const { return slot_arguments[p_slot]; }
+	_FORCE_INLINE_ int get_predicate_count() const { return predicates.size(); }
+	_FORCE_INLINE_ int get_slot_count() const { return slot_predicates.size(); }
+	_FORCE_INLINE_ int get_string_count() const { return strings.size(); }
+};
+
+// World state as a dense table of typed values indexed by layout slot.
+// Goal checks and effects compare and write slots directly instead of hashing
+// the nested Dictionary keys. The layout must outlive every state built on it.
+class PlannerFlatState {
+public:
+	enum SlotType : uint8_t {
+		SLOT_EMPTY,
+		SLOT_BOOL,
+		SLOT_INT,
+		SLOT_FLOAT,
+		SLOT_STRING, // Interned string id
+		SLOT_VARIANT, // Index into this state's variant values, for anything else
+	};
+
+	struct Value {
+		SlotType type = SLOT_EMPTY;
+		union {
+			int64_t integer = 0;
+			double real;
+		};
+	};
+
+	// A compiled unigoal: the slot to test and the value it must hold.
+	struct Goal {
+		int slot = -1;
+		Value value;
+		Variant variant; // Used when value.type is SLOT_VARIANT
+	};
+
+private:
+	PlannerStateLayout *layout = nullptr;
+	LocalVector<Value> values;
+	LocalVector<Variant> variant_values;
+	LocalVector<uint8_t> dictionary_predicates; // Predicates stored as a nested Dictionary, even when empty
+
+	Value _encode(const Variant &p_value, int64_t p_variant_index = -1);
+	static bool _values_equal(const Value &p_a, const Value &p_b);
+	void _mark_dictionary_predicate(int p_predicate_id);
+	void _prepare_slot(int p_slot);
+
+public:
+	PlannerFlatState() {}
+	explicit PlannerFlatState(PlannerStateLayout *p_layout) :
+			layout(p_layout) {}
+
+	static PlannerFlatState from_dictionary(PlannerStateLayout *p_layout, const Dictionary &p_state);
+	Dictionary to_dictionary() const;
+
+	// PlannerState keeps subject -> predicate -> value, so a subject maps to an argument.
+	// Entity capabilities become the "entity_capabilities" variable used by Dictionary states.
+	static PlannerFlatState from_planner_state(PlannerStateLayout *p_layout, const Ref<PlannerState> &p_state);
+	Ref<PlannerState> to_planner_state() const; // Skips values PlannerState cannot hold
+
+	_FORCE_INLINE_ PlannerStateLayout *get_layout() const { return layout; }
+
+	_FORCE_INLINE_ bool has_value(int p_slot) const { return p_slot >= 0 && p_slot < (int)values.size() && values[p_slot].type != SLOT_EMPTY; }
+	_FORCE_INLINE_ SlotType get_slot_type(int p_slot) const { return has_value(p_slot) ? values[p_slot].type : SLOT_EMPTY; }
+	Variant get_value(int p_slot) const;
+	void set_value(int p_slot, const Variant &p_value);
+	void clear_value(int p_slot);
+
+	// Typed access for C++ effects, no Variant round trip
+	bool get_bool(int p_slot, bool p_default = false) const;
+	int64_t get_int(int p_slot, int64_t p_default = 0) const;
+	double get_float(int p_slot, double p_default = 0.0) const;
+	int get_string_id(int p_slot) const; // -1 if the slot does not hold a string
+	void set_bool(int p_slot, bool p_value);
+	void set_int(int p_slot, int64_t p_value);
+	void set_float(int p_slot, double p_value);
+	void set_string_id(int p_slot, int p_string_id);
+
+	static Goal compile_goal(PlannerStateLayout *p_layout, const Variant &p_predicate, const Variant &p_argument, const Variant &p_value);
+	static LocalVector<Goal> compile_multigoal(PlannerStateLayout *p_layout, const Dictionary &p_multigoal);
+	bool is_goal_achieved(const Goal &p_goal) const;
+	// Flat counterpart of PlannerMultigoal::method_goals_not_achieved; writes the indices of unmet goals
+	void get_goals_not_achieved(const LocalVector<Goal> &p_goals, LocalVector<int> &r_unmet) const;
+	bool are_goals_achieved(const LocalVector<Goal> &p_goals) const;
+};
@@ -0,0 +1,235 @@
+/**************************************************************************/
+/*  planner_persistent_state.cpp                                          */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "planner_persistent_state.h"
+
+PlannerPersistentState::Variable PlannerPersistentState::_make_variable(const Variant &p_value) {
+	Variable variable;
+	if (p_value.get_type() != Variant::DICTIONARY) {
+		variable.value = p_value;
+		return variable;
+	}
+	variable.is_dictionary = true;
+	Dictionary arguments = p_value;
+	Array argument_keys = arguments.keys();
+	for (int i = 0; i < argument_keys.size(); i++) {
+		variable.arguments = variable.arguments.with(argument_keys[i], arguments[argument_keys[i]]);
+	}
+	return variable;
+}
+
+PlannerPersistentState PlannerPersistentState::from_dictionary(const Dictionary &p_state) {
+	PlannerPersistentState state;
+	Array variable_keys = p_state.keys();
+	for (int i = 0; i < variable_keys.size(); i++) {
+		state.variables = state.variables.with(variable_keys[i], _make_variable(p_state[variable_keys[i]]));
+	}
+	return state;
+}
+
+Dictionary PlannerPersistentState::build_dictionary() const {
+	Dictionary state;
+	variables.for_each([&state](const Variant &p_variable, const Variable &p_entry) {
+		if (!p_entry.is_dictionary) {
+			state[p_variable] = p_entry.value;
+			return;
+		}
+		Dictionary arguments;
+		p_entry.arguments.for_each([&arguments](const Variant &p_argument, const Variant &p_value) {
+			arguments[p_argument] = p_value;
+		});
+		state[p_variable] = arguments;
+	});
+	return state;
+}
+
+Dictionary PlannerPersistentState::to_dictionary() const {
+	if (has_view) {
+		return view;
+	}
+	Dictionary state = build_dictionary();
+	for (const Variant *variable = state.next(nullptr); variable; variable = state.next(variable)) {
+		Variant *value = state.getptr(*variable);
+		if (value->get_type() == Variant::DICTIONARY) {
+			Dictionary arguments = *value;
+			arguments.make_read_only();
+		}
+	}
+	state.make_read_only();
+	view = state;
+	has_view = true;
+	return view;
+}
+
+int PlannerPersistentState::count_nodes_not_shared_with(const PlannerPersistentState &p_base) const {
+	int count = variables.count_nodes_not_shared_with(p_base.variables);
+	variables.for_each([&count, &p_base](const Variant &p_variable, const Variable &p_entry) {
+		if (!p_entry.is_dictionary) {
+			return;
+		}
+		const Variable *base_entry = p_base.variables.getptr(p_variable);
+		if (base_entry && base_entry->is_dictionary) {
+			count += p_entry.arguments.count_nodes_not_shared_with(base_entry->arguments);
+		} else {
+			count += p_entry.arguments.count_nodes_not_shared_with(PlannerPersistentMap<Variant>());
+		}
+	});
+	return count;
+}
+
+PlannerPersistentState PlannerPersistentState::updated_from(const Dictionary &p_state) const {
+	PlannerPersistentState result;
+	result.variables = variables;
+
+	Array variable_keys = p_state.keys();
+	for (int i = 0; i < variable_keys.size(); i++) {
+		const Variant &variable_key = variable_keys[i];
+		Variant new_value = p_state[variable_key];
+		const Variable *old_entry = variables.getptr(variable_key);
+
+		if (new_value.get_type() != Variant::DICTIONARY) {
+			if (!old_entry || old_entry->is_dictionary || old_entry->value != new_value) {
+				result.variables = result.variables.with(variable_key, _make_variable(new_value));
+			}
+			continue;
+		}
+
+		Dictionary new_arguments = new_value;
+		if (!old_entry || !old_entry->is_dictionary) {
+			result.variables = result.variables.with(variable_key, _make_variable(new_value));
+			continue;
+		}
+		if (has_view) {
+			// Actions replace the nested dictionaries they change, so an unchanged Dictionary means an unchanged variable
+			Variant view_value = view.get(variable_key, Variant());
+			if (view_value.get_type() == Variant::DICTIONARY && Dictionary(view_value).id() == new_arguments.id()) {
+				continue;
+			}
+		}
+
+		Variable updated = *old_entry;
+		Array argument_keys = new_arguments.keys();
+		for (int j = 0; j < argument_keys.size(); j++) {
+			const Variant &argument = argument_keys[j];
+			Variant argument_value = new_arguments[argument];
+			const Variant *old_value = old_entry->arguments.getptr(argument);
+			if (!old_value || *old_value != argument_value) {
+				updated.arguments = updated.arguments.with(argument, argument_value);
+			}
+		}
+		if (updated.arguments.size() != new_arguments.size()) {
+			old_entry->arguments.for_each([&updated, &new_arguments](const Variant &p_argument, const Variant &p_value) {
+				if (!new_arguments.has(p_argument)) {
+					updated.arguments = updated.arguments.without(p_argument);
+				}
+			});
+		}
+		if (!updated.arguments.is_same(old_entry->arguments)) {
+			result.variables = result.variables.with(variable_key, updated);
+		}
+	}
+
+	if (result.variables.size() != p_state.size()) {
+		variables.for_each([&result, &p_state](const Variant &p_variable, const Variable &p_entry) {
+			if (!p_state.has(p_variable)) {
+				result.variables = result.variables.without(p_variable);
+			}
+		});
+	}
+
+	result.view = p_state;
+	result.view.make_read_only();
+	result.has_view = true;
+	return result;
+}
+
+Variant PlannerPersistentState::get_variable(const Variant &p_variable) const {
+	if (has_view) {
+		return view.get(p_variable, Variant());
+	}
+	const Variable *entry = variables.getptr(p_variable);
+	if (!entry) {
+		return Variant();
+	}
+	if (!entry->is_dictionary) {
+		return entry->value;
+	}
+	Dictionary arguments;
+	entry->arguments.for_each([&arguments](const Variant &p_argument, const Variant &p_value) {
+		arguments[p_argument] = p_value;
+	});
+	return arguments;
+}
+
+const Variant *PlannerPersistentState::get_value(const Variant &p_variable, const Variant &p_argument) const {
+	const Variable *entry = variables.getptr(p_variable);
+	if (!entry || !entry->is_dictionary) {
+		return nullptr;
+	}
+	return entry->arguments.getptr(p_argument);
+}
+
+PlannerPersistentState PlannerPersistentState::with_variable(const Variant &p_variable, const Variant &p_value) const {
+	PlannerPersistentState result;
+	result.variables = variables.with(p_variable, _make_variable(p_value));
+	return result;
+}
+
+PlannerPersistentState PlannerPersistentState::with_value(const Variant &p_variable, const Variant &p_argument, const Variant &p_value) const {
+	Variable updated;
+	const Variable *entry = variables.getptr(p_variable);
+	if (entry && entry->is_dictionary) {
+		updated = *entry;
+	}
+	updated.is_dictionary = true;
+	updated.value = Variant();
+	updated.arguments = updated.arguments.with(p_argument, p_value);
+	PlannerPersistentState result;
+	result.variables = variables.with(p_variable, updated);
+	return result;
+}
+
+PlannerPersistentState PlannerPersistentState::without_variable(const Variant &p_variable) const {
+	PlannerPersistentState result;
+	result.variables = variables.without(p_variable);
+	return result;
+}
+
+PlannerPersistentState PlannerPersistentState::without_value(const Variant &p_variable, const Variant &p_argument) const {
+	const Variable *entry = variables.getptr(p_variable);
+	if (!entry || !entry->is_dictionary || !entry->arguments.has(p_argument)) {
+		return *this;
+	}
+	Variable updated = *entry;
+	updated.arguments = updated.arguments.without(p_argument);
+	PlannerPersistentState result;
+	result.variables = variables.with(p_variable, updated);
+	return result;
+}
@@ -0,0 +1,382 @@
+/**************************************************************************/
+/*  planner_persistent_state.h                                            */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+// SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
+// SPDX-License-Identifier: MIT
+
+#include "core/templates/hash_set.h"
+#include "core/templates/local_vector.h"
+#include "core/templates/safe_refcount.h"
+#include "core/variant/dictionary.h"
+#include "core/variant/variant.h"
+
+// Hash array mapped trie keyed by Variant, compared like Dictionary keys.
+// Updates copy only the path to the changed leaf and share every other node
+// with the previous version, so versions are cheap to keep and to branch.
+// Nodes are reference counted atomically; versions can cross threads.
+template <typename V>
+class PlannerPersistentMap {
+	static constexpr uint32_t BITS = 5;
+	static constexpr uint32_t MASK = (1 << BITS) - 1;
+	static constexpr uint32_t MAX_SHIFT = 30; // Deeper nodes hold keys whose hashes fully collide
+
+	struct Node;
+
+	struct Entry {
+		Node *child = nullptr; // Subtree, or nullptr for a leaf
+		uint32_t hash = 0;
+		Variant key;
+		V value;
+	};
+
+	struct Node {
+		SafeRefCount refcount;
+		uint32_t bitmap = 0; // Occupied positions; unused by collision nodes
+		LocalVector<Entry> entries; // Ordered by position
+	};
+
+	Node *root = nullptr;
+	int count = 0;
+
+	_FORCE_INLINE_ static uint32_t _popcount(uint32_t p_value) {
+		p_value = p_value - ((p_value >> 1) & 0x55555555);
+		p_value = (p_value & 0x33333333) + ((p_value >> 2) & 0x33333333);
+		return (((p_value + (p_value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+	}
+
+	_FORCE_INLINE_ static bool _same_key(const Entry &p_entry, uint32_t p_hash, const Variant &p_key) {
+		return !p_entry.child && p_entry.hash == p_hash && StringLikeVariantComparator::compare(p_entry.key, p_key);
+	}
+
+	static Node *_new_node() {
+		Node *node = memnew(Node);
+		node->refcount.init();
+		return node;
+	}
+
+	_FORCE_INLINE_ static Node *_ref(const Node *p_node) {
+		Node *node = const_cast<Node *>(p_node);
+		if (node) {
+			node->refcount.ref();
+		}
+		return node;
+	}
+
+	static void _unref(Node *p_node) {
+		if (p_node && p_node->refcount.unref()) {
+			for (Entry &entry : p_node->entries) {
+				_unref(entry.child);
+			}
+			memdelete(p_node);
+		}
+	}
+
+	static Node *_copy(const Node *p_node) {
+		Node *node = _new_node();
+		node->bitmap = p_node->bitmap;
+		node->entries = p_node->entries;
+		for (Entry &entry : node->entries) {
+			_ref(entry.child);
+		}
+		return node;
+	}
+
+	static Entry _make_leaf(uint32_t p_hash, const Variant &p_key, const V &p_value) {
+		Entry leaf;
+		leaf.hash = p_hash;
+		leaf.key = p_key;
+		leaf.value = p_value;
+		return leaf;
+	}
+
+	// Returns a new node holding one reference.
+	static Node *_insert(const Node *p_node, uint32_t p_hash, const Variant &p_key, const V &p_value, uint32_t p_shift, bool &r_added) {
+		Node *node = p_node ? _copy(p_node) : _new_node();
+		if (p_shift > MAX_SHIFT) {
+			for (Entry &entry : node->entries) {
+				if (_same_key(entry, p_hash, p_key)) {
+					entry.value = p_value;
+					return node;
+				}
+			}
+			node->entries.push_back(_make_leaf(p_hash, p_key, p_value));
+			r_added = true;
+			return node;
+		}
+
+		uint32_t bit = 1u << ((p_hash >> p_shift) & MASK);
+		uint32_t index = _popcount(node->bitmap & (bit - 1));
+		if (!(node->bitmap & bit)) {
+			node->entries.insert(index, _make_leaf(p_hash, p_key, p_value));
+			node->bitmap |= bit;
+			r_added = true;
+			return node;
+		}
+
+		Entry &entry = node->entries[index];
+		if (entry.child) {
+			Node *child = _insert(entry.child, p_hash, p_key, p_value, p_shift + BITS, r_added);
+			_unref(entry.child);
+			entry.child = child;
+		} else if (_same_key(entry, p_hash, p_key)) {
+			entry.value = p_value;
+		} else {
+			// Two keys share this position, push both one level down
+			bool pushed_down = false;
+			Node *child = _insert(nullptr, entry.hash, entry.key, entry.value, p_shift + BITS, pushed_down);
+			Node *merged = _insert(child, p_hash, p_key, p_value, p_shift + BITS, r_added);
+			_unref(child);
+			entry.child = merged;
+			entry.key = Variant();
+			entry.value = V();
+		}
+		return node;
+	}
+
+	// Returns a node holding one reference, nullptr if it ended up empty, or
+	// p_node itself (referenced again) if the key was absent.
+	static Node *_erase(const Node *p_node, uint32_t p_hash, const Variant &p_key, uint32_t p_shift, bool &r_removed) {
+		if (!p_node) {
+			return nullptr;
+		}
+		if (p_shift > MAX_SHIFT) {
+			for (uint32_t i = 0; i < p_node->entries.size(); i++) {
+				if (_same_key(p_node->entries[i], p_hash, p_key)) {
+					r_removed = true;
+					if (p_node->entries.size() == 1) {
+						return nullptr;
+					}
+					Node *node = _copy(p_node);
+					node->entries.remove_at(i);
+					return node;
+				}
+			}
+			return _ref(p_node);
+		}
+
+		uint32_t bit = 1u << ((p_hash >> p_shift) & MASK);
+		if (!(p_node->bitmap & bit)) {
+			return _ref(p_node);
+		}
+		uint32_t index = _popcount(p_node->bitmap & (bit - 1));
+		const Entry &entry = p_node->entries[index];
+		Node *child = nullptr;
+		if (entry.child) {
+			child = _erase(entry.child, p_hash, p_key, p_shift + BITS, r_removed);
+			if (!r_removed) {
+				_unref(child);
+				return _ref(p_node);
+			}
+		} else if (_same_key(entry, p_hash, p_key)) {
+			r_removed = true;
+		} else {
+			return _ref(p_node);
+		}
+
+		if (!child && p_node->entries.size() == 1) {
+			return nullptr;
+		}
+		Node *node = _copy(p_node);
+		_unref(node->entries[index].child);
+		if (child) {
+			node->entries[index].child = child;
+		} else {
+			node->entries.remove_at(index);
+			node->bitmap &= ~bit;
+		}
+		return node;
+	}
+
+	template <typename F>
+	static void _for_each(const Node *p_node, F &p_function) {
+		if (!p_node) {
+			return;
+		}
+		for (const Entry &entry : p_node->entries) {
+			if (entry.child) {
+				_for_each(entry.child, p_function);
+			} else {
+				p_function(entry.key, entry.value);
+			}
+		}
+	}
+
+	static void _collect_nodes(const Node *p_node, HashSet<const Node *> &r_nodes) {
+		if (!p_node) {
+			return;
+		}
+		r_nodes.insert(p_node);
+		for (const Entry &entry : p_node->entries) {
+			_collect_nodes(entry.child, r_nodes);
+		}
+	}
+
+	static int _count_nodes_not_in(const Node *p_node, const HashSet<const Node *> &p_nodes) {
+		if (!p_node || p_nodes.has(p_node)) {
+			return 0;
+		}
+		int count = 1;
+		for (const Entry &entry : p_node->entries) {
+			count += _count_nodes_not_in(entry.child, p_nodes);
+		}
+		return count;
+	}
+
+	PlannerPersistentMap(Node *p_root, int p_count) :
+			root(p_root), count(p_count) {}
+
+public:
+	_FORCE_INLINE_ int size() const { return count; }
+	_FORCE_INLINE_ bool is_empty() const { return count == 0; }
+	// True if both versions are the same tree, without comparing contents
+	_FORCE_INLINE_ bool is_same(const PlannerPersistentMap &p_other) const { return root == p_other.root; }
+
+	const V *getptr(const Variant &p_key) const {
+		uint32_t hash = p_key.hash();
+		const Node *node = root;
+		uint32_t shift = 0;
+		while (node) {
+			if (shift > MAX_SHIFT) {
+				for (const Entry &entry : node->entries) {
+					if (_same_key(entry, hash, p_key)) {
+						return &entry.value;
+					}
+				}
+				return nullptr;
+			}
+			uint32_t bit = 1u << ((hash >> shift) & MASK);
+			if (!(node->bitmap & bit)) {
+				return nullptr;
+			}
+			const Entry &entry = node->entries[_popcount(node->bitmap & (bit - 1))];
+			if (!entry.child) {
+				return _same_key(entry, hash, p_key) ? &entry.value : nullptr;
+			}
+			node = entry.child;
+			shift += BITS;
+		}
+		return nullptr;
+	}
+
+	_FORCE_INLINE_ bool has(const Variant &p_key) const { return getptr(p_key) != nullptr; }
+
+	PlannerPersistentMap with(const Variant &p_key, const V &p_value) const {
+		bool added = false;
+		Node *new_root = _insert(root, p_key.hash(), p_key, p_value, 0, added);
+		return PlannerPersistentMap(new_root, count + (added ? 1 : 0));
+	}
+
+	PlannerPersistentMap without(const Variant &p_key) const {
+		bool removed = false;
+		Node *new_root = _erase(root, p_key.hash(), p_key, 0, removed);
+		return PlannerPersistentMap(new_root, count - (removed ? 1 : 0));
+	}
+
+	// Number of trie nodes in this version that p_base does not share, which is the
+	// memory keeping both versions costs over keeping p_base. Walks both versions.
+	int count_nodes_not_shared_with(const PlannerPersistentMap &p_base) const {
+		if (root == p_base.root) {
+			return 0;
+		}
+		HashSet<const Node *> base_nodes;
+		_collect_nodes(p_base.root, base_nodes);
+		return _count_nodes_not_in(root, base_nodes);
+	}
+
+	// Calls p_function(const Variant &key, const V &value) for every entry
+	template <typename F>
+	void for_each(F p_function) const {
+		_for_each(root, p_function);
+	}
+
+	void operator=(const PlannerPersistentMap &p_other) {
+		if (root != p_other.root) {
+			_unref(root);
+			root = _ref(p_other.root);
+		}
+		count = p_other.count;
+	}
+
+	PlannerPersistentMap() {}
+	PlannerPersistentMap(const PlannerPersistentMap &p_other) :
+			root(_ref(p_other.root)), count(p_other.count) {}
+	~PlannerPersistentMap() { _unref(root); }
+};
+
+// World state as a persistent map of state variables, each either a plain value
+// or a persistent map of arguments. Scripted actions still see a Dictionary:
+// to_dictionary() builds it on demand, and updated_from() turns the Dictionary an
+// action returned into a new version that shares every variable it left alone.
+// Versions save memory, not time: building a Dictionary from one reads every entry.
+class PlannerPersistentState {
+public:
+	struct Variable {
+		Variant value; // Used when the variable is not a Dictionary
+		PlannerPersistentMap<Variant> arguments;
+		bool is_dictionary = false;
+	};
+
+private:
+	PlannerPersistentMap<Variable> variables;
+	// Read-only Dictionary view, cached per instance; do not share one instance between threads
+	mutable Dictionary view;
+	mutable bool has_view = false;
+
+	static Variable _make_variable(const Variant &p_value);
+
+public:
+	static PlannerPersistentState from_dictionary(const Dictionary &p_state);
+	// Read-only view, built once and cached in this instance
+	Dictionary to_dictionary() const;
+	// New writable Dictionary on every call; nothing is cached
+	Dictionary build_dictionary() const;
+
+	// Returns a version equal to p_state that shares every variable whose nested
+	// Dictionary is still the one in this version's view, or whose arguments are
+	// unchanged. p_state is frozen and kept as the new version's view.
+	PlannerPersistentState updated_from(const Dictionary &p_state) const;
+
+	_FORCE_INLINE_ int get_variable_count() const { return variables.size(); }
+	_FORCE_INLINE_ bool has_variable(const Variant &p_variable) const { return variables.has(p_variable); }
+	_FORCE_INLINE_ const Variable *get_variable_entry(const Variant &p_variable) const { return variables.getptr(p_variable); }
+	_FORCE_INLINE_ bool is_same_version(const PlannerPersistentState &p_other) const { return variables.is_same(p_other.variables); }
+	Variant get_variable(const Variant &p_variable) const;
+	// Trie nodes of this version and of its nested argument maps that p_base does not share
+	int count_nodes_not_shared_with(const PlannerPersistentState &p_base) const;
+	const Variant *get_value(const Variant &p_variable, const Variant &p_argument) const;
+
+	// O(log n) updates returning a new version
+	PlannerPersistentState with_variable(const Variant &p_variable, const Variant &p_value) const;
+	PlannerPersistentState with_value(const Variant &p_variable, const Variant &p_argument, const Variant &p_value) const;
+	PlannerPersistentState without_variable(const Variant &p_variable) const;
+	PlannerPersistentState without_value(const Variant &p_variable, const Variant &p_argument) const;
+};
@@ -0,0 +1,110 @@
+/**************************************************************************/
+/*  planner_session.cpp                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "planner_session.h"
+
+#include "domain.h"
+
+void PlannerSession::set_plan(const Ref<PlannerPlan> &p_plan) {
+	ERR_FAIL_COND_MSG(started && !cursor.done, "Cannot change the plan of a session that is still running.");
+	plan = p_plan;
+}
+
+Ref<PlannerPlan> PlannerSession::get_plan() const {
+	return plan;
+}
+
+bool PlannerSession::begin(Dictionary p_state, Array p_todo_list) {
+	ERR_FAIL_COND_V_MSG(plan.is_null(), false, "PlannerSession needs a plan before begin().");
+	ERR_FAIL_COND_V_MSG(plan->get_current_domain().is_null(), false, "PlannerSession plan has no current domain.");
+
+	// Edits to the domain between slices must not reach the search halfway through
+	worker = plan->_create_worker(plan->get_current_domain()->create_snapshot());
+	worker->_begin_planning(p_state, p_todo_list, cursor);
+	started = true;
+	status = PlannerPlan::PLAN_STATUS_NONE;
+	result = Variant();
+	return true;
+}
+
+bool PlannerSession::step(int p_max_expansions, int64_t p_max_usec) {
+	ERR_FAIL_COND_V_MSG(!started, true, "PlannerSession::begin() must be called before step().");
+	if (cursor.done) {
+		return true;
+	}
+
+	if (!worker->_run_planning_steps(cursor, p_max_expansions, p_max_usec > 0 ? uint64_t(p_max_usec) : 0)) {
+		return false;
+	}
+
+	result = worker->_finish_plan(cursor.state);
+	status = worker->get_last_plan_status();
+	return true;
+}
+
+bool PlannerSession::is_done() const {
+	return started && cursor.done;
+}
+
+Variant PlannerSession::get_result() const {
+	return result;
+}
+
+PlannerPlan::PlanStatus PlannerSession::get_status() const {
+	return status;
+}
+
+int PlannerSession::get_expansion_count() const {
+	return cursor.expansions;
+}
+
+Dictionary PlannerSession::get_state() const {
+	// The search and its node snapshots share this state, so the caller gets a copy
+	return cursor.state.duplicate(true);
+}
+
+int64_t PlannerSession::get_state_hash() const {
+	return int64_t(cursor.state_hash);
+}
+
+void PlannerSession::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_plan"), &PlannerSession::get_plan);
+	ClassDB::bind_method(D_METHOD("set_plan", "plan"), &PlannerSession::set_plan);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "plan", PROPERTY_HINT_RESOURCE_TYPE, "PlannerPlan"), "set_plan", "get_plan");
+
+	ClassDB::bind_method(D_METHOD("begin", "state", "todo_list"), &PlannerSession::begin);
+	ClassDB::bind_method(D_METHOD("step", "max_expansions", "max_usec"), &PlannerSession::step, DEFVAL(0), DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("is_done"), &PlannerSession::is_done);
+	ClassDB::bind_method(D_METHOD("get_result"), &PlannerSession::get_result);
+	ClassDB::bind_method(D_METHOD("get_status"), &PlannerSession::get_status);
+	ClassDB::bind_method(D_METHOD("get_expansion_count"), &PlannerSession::get_expansion_count);
+	ClassDB::bind_method(D_METHOD("get_state"), &PlannerSession::get_state);
+	ClassDB::bind_method(D_METHOD("get_state_hash"), &PlannerSession::get_state_hash);
+}
@@ -0,0 +1,70 @@
+/**************************************************************************/
+/*  planner_session.h                                                     */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+// SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
+// SPDX-License-Identifier: MIT
+
+#include "core/object/ref_counted.h"
+#include "core/variant/dictionary.h"
+
+#include "modules/goal_task_planner/plan.h"
+
+// Resumable find_plan(): the search runs in slices bounded by expansions or
+// microseconds. The session drives a worker plan with the plan's domain and
+// settings, so the plan itself stays free for other searches between slices.
+// The cursor keeps the parent node id and state between slices.
+class PlannerSession : public RefCounted {
+	GDCLASS(PlannerSession, RefCounted);
+
+	Ref<PlannerPlan> plan;
+	Ref<PlannerPlan> worker; // Owns the solution graph and STN of the running search
+	PlannerPlan::PlanningCursor cursor;
+	bool started = false;
+	PlannerPlan::PlanStatus status = PlannerPlan::PLAN_STATUS_NONE;
+	Variant result;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_plan(const Ref<PlannerPlan> &p_plan);
+	Ref<PlannerPlan> get_plan() const;
+
+	bool begin(Dictionary p_state, Array p_todo_list);
+	bool step(int p_max_expansions = 0, int64_t p_max_usec = 0);
+	bool is_done() const;
+	Variant get_result() const;
+	PlannerPlan::PlanStatus get_status() const;
+	int get_expansion_count() const;
+	Dictionary get_state() const;
+	int64_t get_state_hash() const;
+};
@@ -38,6 +38,8 @@
 class PlannerState : public Resource {
 	GDCLASS(PlannerState, Resource);
 
+	friend class PlannerFlatState;
+
 	Dictionary data;
 	Dictionary entity_capabilities; // entity_id -> Dictionary of capabilities
 
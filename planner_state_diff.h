@@ -0,0 +1,107 @@
+/**************************************************************************/
+/*  planner_state_diff.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+// SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
+// SPDX-License-Identifier: MIT
+
+#include "core/variant/dictionary.h"
+#include "core/variant/variant.h"
+
+// Argument-level half of planner_for_each_state_change() for one nested dictionary.
+// Returns the number of argument entries it read.
+template <typename F>
+int planner_for_each_argument_change(const Variant &p_variable, const Dictionary &p_old_arguments, const Dictionary &p_new_arguments, F &p_on_change) {
+	int kept = 0;
+	for (const Variant *argument = p_new_arguments.next(nullptr); argument; argument = p_new_arguments.next(argument)) {
+		const Variant *new_value = p_new_arguments.getptr(*argument);
+		const Variant *old_value = p_old_arguments.getptr(*argument);
+		if (!old_value) {
+			p_on_change(p_variable, argument, nullptr, new_value);
+			continue;
+		}
+		kept++;
+		if (*new_value != *old_value) {
+			p_on_change(p_variable, argument, old_value, new_value);
+		}
+	}
+	if (kept == p_old_arguments.size()) {
+		return p_new_arguments.size();
+	}
+	for (const Variant *argument = p_old_arguments.next(nullptr); argument; argument = p_old_arguments.next(argument)) {
+		if (!p_new_arguments.has(*argument)) {
+			p_on_change(p_variable, argument, p_old_arguments.getptr(*argument), nullptr);
+		}
+	}
+	return p_new_arguments.size() + p_old_arguments.size();
+}
+
+// Walks the differences between the state before and after an action.
+// Calls p_on_change(variable, argument, old_value, new_value) once per change,
+// where argument is nullptr for a change to the whole variable and a missing
+// old or new value is nullptr. Nested dictionaries that kept their identity are
+// skipped without reading their entries: actions replace the nested
+// dictionaries they change, so one the old state still holds has not been edited.
+// Iterates in place without building key arrays, and only walks the old side
+// again when it has entries the new side lacks. Returns the number of nested
+// argument entries it read, which is zero for variables the action left alone.
+template <typename F>
+int planner_for_each_state_change(const Dictionary &p_old_state, const Dictionary &p_new_state, F p_on_change) {
+	int kept = 0;
+	int arguments_read = 0;
+	for (const Variant *variable = p_new_state.next(nullptr); variable; variable = p_new_state.next(variable)) {
+		const Variant *new_value = p_new_state.getptr(*variable);
+		const Variant *old_value = p_old_state.getptr(*variable);
+		if (!old_value) {
+			p_on_change(*variable, nullptr, nullptr, new_value);
+			continue;
+		}
+		kept++;
+		if (old_value->get_type() == Variant::DICTIONARY && new_value->get_type() == Variant::DICTIONARY) {
+			Dictionary old_arguments = *old_value;
+			Dictionary new_arguments = *new_value;
+			if (old_arguments.id() != new_arguments.id()) {
+				arguments_read += planner_for_each_argument_change(*variable, old_arguments, new_arguments, p_on_change);
+			}
+		} else if (*new_value != *old_value) {
+			p_on_change(*variable, nullptr, old_value, new_value);
+		}
+	}
+	if (kept == p_old_state.size()) {
+		return arguments_read;
+	}
+	for (const Variant *variable = p_old_state.next(nullptr); variable; variable = p_old_state.next(variable)) {
+		if (!p_new_state.has(*variable)) {
+			p_on_change(*variable, nullptr, p_old_state.getptr(*variable), nullptr);
+		}
+	}
+	return arguments_read;
+}
@@ -0,0 +1,108 @@
+/**************************************************************************/
+/*  planner_state_hash.cpp                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "planner_state_hash.h"
+
+#include "planner_state_diff.h"
+
+static constexpr uint64_t PLANNER_HASH_ARGUMENT_SEED = 0x9e3779b97f4a7c15;
+static constexpr uint64_t PLANNER_HASH_VALUE_SEED = 0xc2b2ae3d27d4eb4f;
+static constexpr uint64_t PLANNER_HASH_SCALAR_SEED = 0x165667b19e3779f9;
+static constexpr uint64_t PLANNER_HASH_DICTIONARY_SEED = 0x27d4eb2f165667c5;
+
+uint64_t PlannerStateHash::_mix(uint64_t p_value) {
+	// splitmix64 finalizer
+	p_value ^= p_value >> 30;
+	p_value *= 0xbf58476d1ce4e5b9;
+	p_value ^= p_value >> 27;
+	p_value *= 0x94d049bb133111eb;
+	p_value ^= p_value >> 31;
+	return p_value;
+}
+
+uint64_t PlannerStateHash::hash_entry(const Variant &p_variable, const Variant &p_argument, const Variant &p_value) {
+	uint64_t key = _mix(p_variable.hash());
+	key = _mix(key ^ (PLANNER_HASH_ARGUMENT_SEED + p_argument.hash()));
+	return _mix(key ^ (PLANNER_HASH_VALUE_SEED + p_value.hash()));
+}
+
+// Contribution of a whole variable: one entry per argument for nested
+// dictionaries plus a marker, so an empty dictionary differs from a missing one.
+uint64_t PlannerStateHash::_variable_key(const Variant &p_variable, const Variant &p_value) {
+	if (p_value.get_type() != Variant::DICTIONARY) {
+		return _mix(_mix(p_variable.hash()) ^ (PLANNER_HASH_SCALAR_SEED + p_value.hash()));
+	}
+	uint64_t key = _mix(_mix(p_variable.hash()) ^ PLANNER_HASH_DICTIONARY_SEED);
+	Dictionary arguments = p_value;
+	for (const Variant *argument = arguments.next(nullptr); argument; argument = arguments.next(argument)) {
+		key ^= hash_entry(p_variable, *argument, *arguments.getptr(*argument));
+	}
+	return key;
+}
+
+uint64_t PlannerStateHash::hash_state(const Dictionary &p_state) {
+	uint64_t hash = 0;
+	for (const Variant *variable = p_state.next(nullptr); variable; variable = p_state.next(variable)) {
+		hash ^= _variable_key(*variable, *p_state.getptr(*variable));
+	}
+	return hash;
+}
+
+uint64_t PlannerStateHash::combine(uint64_t p_hash, uint64_t p_value) {
+	return _mix(p_hash ^ (PLANNER_HASH_ARGUMENT_SEED + p_value));
+}
+
+uint64_t PlannerStateHash::change_key(const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value) {
+	uint64_t key = 0;
+	if (p_argument) {
+		if (p_old_value) {
+			key ^= hash_entry(p_variable, *p_argument, *p_old_value);
+		}
+		if (p_new_value) {
+			key ^= hash_entry(p_variable, *p_argument, *p_new_value);
+		}
+		return key;
+	}
+	if (p_old_value) {
+		key ^= _variable_key(p_variable, *p_old_value);
+	}
+	if (p_new_value) {
+		key ^= _variable_key(p_variable, *p_new_value);
+	}
+	return key;
+}
+
+uint64_t PlannerStateHash::update(uint64_t p_old_hash, const Dictionary &p_old_state, const Dictionary &p_new_state) {
+	uint64_t hash = p_old_hash;
+	planner_for_each_state_change(p_old_state, p_new_state, [&hash](const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value) {
+		hash ^= change_key(p_variable, p_argument, p_old_value, p_new_value);
+	});
+	return hash;
+}
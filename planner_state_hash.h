@@ -0,0 +1,58 @@
+/**************************************************************************/
+/*  planner_state_hash.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+// SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
+// SPDX-License-Identifier: MIT
+
+#include "core/typedefs.h"
+#include "core/variant/dictionary.h"
+#include "core/variant/variant.h"
+
+// 64-bit Zobrist-style state hash. Every (variable, argument, value) entry maps
+// to a well-mixed 64-bit key and the state hash is the XOR of its entries, so an
+// action's changes update it in time proportional to what the action touched.
+// Keys are derived by mixing Variant hashes rather than drawn from a random
+// table, because state variables are not known up front.
+class PlannerStateHash {
+	static uint64_t _mix(uint64_t p_value);
+	static uint64_t _variable_key(const Variant &p_variable, const Variant &p_value);
+
+public:
+	static uint64_t hash_entry(const Variant &p_variable, const Variant &p_argument, const Variant &p_value);
+	static uint64_t hash_state(const Dictionary &p_state);
+	// Folds p_value into p_hash, for keys built from a state hash and other fields
+	static uint64_t combine(uint64_t p_hash, uint64_t p_value);
+	// XOR this into a state hash to apply one change reported by planner_for_each_state_change()
+	static uint64_t change_key(const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value);
+	// Hash of p_new_state, given p_old_hash is the hash of p_old_state
+	static uint64_t update(uint64_t p_old_hash, const Dictionary &p_old_state, const Dictionary &p_new_state);
+};
@@ -0,0 +1,290 @@
+/**************************************************************************/
+/*  solution_graph.cpp                                                    */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "solution_graph.h"
+
+#include "planner_state_diff.h"
+
+PlannerSolutionGraph::PlannerSolutionGraph() {
+	// Initialize root node (node 0)
+	int root_id = create_node(PlannerNodeType::TYPE_ROOT, Variant("root"));
+	set_node_status(root_id, PlannerNodeStatus::STATUS_NOT_APPLICABLE);
+}
+
+int PlannerSolutionGraph::create_node(PlannerNodeType p_type, const Variant &p_info, const TypedArray<Callable> &p_available_methods, const Callable &p_action) {
+	int node_id = node_types.size();
+	node_types.push_back(static_cast<uint8_t>(p_type));
+	node_statuses.push_back(static_cast<uint8_t>(PlannerNodeStatus::STATUS_OPEN));
+	node_alive.push_back(1);
+	node_parents.push_back(NO_NODE);
+	node_depths.push_back(0);
+	node_first_children.push_back(NO_NODE);
+	node_last_children.push_back(NO_NODE);
+	node_next_siblings.push_back(NO_NODE);
+	node_selected_methods.push_back(-1);
+	node_snapshots.push_back(-1);
+	node_infos.push_back(p_info);
+	node_available_methods.push_back(p_available_methods);
+	node_actions.push_back(p_action);
+	node_start_times.push_back(0);
+	node_end_times.push_back(0);
+	node_durations.push_back(0);
+	node_count++;
+	return node_id;
+}
+
+void PlannerSolutionGraph::add_successor(int p_parent_id, int p_child_id) {
+	ERR_FAIL_COND(!has_node(p_parent_id) || !has_node(p_child_id));
+	node_parents[p_child_id] = p_parent_id;
+	node_depths[p_child_id] = node_depths[p_parent_id] + 1;
+	node_next_siblings[p_child_id] = NO_NODE;
+	int last = node_last_children[p_parent_id];
+	if (last == NO_NODE) {
+		node_first_children[p_parent_id] = p_child_id;
+	} else {
+		node_next_siblings[last] = p_child_id;
+	}
+	node_last_children[p_parent_id] = p_child_id;
+}
+
+void PlannerSolutionGraph::remove_node(int p_node_id) {
+	ERR_FAIL_COND(!has_node(p_node_id));
+	node_alive[p_node_id] = 0;
+	node_parents[p_node_id] = NO_NODE;
+	node_first_children[p_node_id] = NO_NODE;
+	node_last_children[p_node_id] = NO_NODE;
+	node_next_siblings[p_node_id] = NO_NODE;
+	_release_snapshot(p_node_id);
+	node_infos[p_node_id] = Variant();
+	node_available_methods[p_node_id] = TypedArray<Callable>();
+	node_actions[p_node_id] = Callable();
+	node_count--;
+}
+
+void PlannerSolutionGraph::clear_successors(int p_node_id) {
+	node_first_children[p_node_id] = NO_NODE;
+	node_last_children[p_node_id] = NO_NODE;
+}
+
+Callable PlannerSolutionGraph::get_selected_method(int p_node_id) const {
+	int method_index = node_selected_methods[p_node_id];
+	const TypedArray<Callable> &methods = node_available_methods[p_node_id];
+	if (method_index < 0 || method_index >= methods.size()) {
+		return Callable();
+	}
+	return methods[method_index];
+}
+
+void PlannerSolutionGraph::set_action_times(int p_node_id, int64_t p_start_time, int64_t p_end_time, int64_t p_duration) {
+	node_start_times[p_node_id] = p_start_time;
+	node_end_times[p_node_id] = p_end_time;
+	node_durations[p_node_id] = p_duration;
+}
+
+TypedArray<int> PlannerSolutionGraph::get_successors(int p_node_id) const {
+	TypedArray<int> successors;
+	for (int child_id = node_first_children[p_node_id]; child_id != NO_NODE; child_id = node_next_siblings[child_id]) {
+		successors.push_back(child_id);
+	}
+	return successors;
+}
+
+int PlannerSolutionGraph::_allocate_snapshot(int p_node_id) {
+	int handle = node_snapshots[p_node_id];
+	if (handle >= 0) {
+		return handle;
+	}
+	if (!free_snapshots.is_empty()) {
+		handle = free_snapshots[free_snapshots.size() - 1];
+		free_snapshots.remove_at(free_snapshots.size() - 1);
+	} else {
+		handle = snapshots.size();
+		snapshots.push_back(NodeSnapshot());
+	}
+	node_snapshots[p_node_id] = handle;
+	return handle;
+}
+
+void PlannerSolutionGraph::_release_snapshot(int p_node_id) {
+	int handle = node_snapshots[p_node_id];
+	if (handle < 0) {
+		return;
+	}
+	snapshots[handle] = NodeSnapshot();
+	free_snapshots.push_back(handle);
+	node_snapshots[p_node_id] = -1;
+}
+
+void PlannerSolutionGraph::save_state_snapshot(int p_node_id, const Dictionary &p_state) {
+	int handle = _allocate_snapshot(p_node_id);
+	snapshots[handle].state = p_state;
+}
+
+Dictionary PlannerSolutionGraph::get_state_snapshot(int p_node_id) const {
+	int handle = node_snapshots[p_node_id];
+	if (handle < 0) {
+		return Dictionary();
+	}
+	if (snapshots[handle].has_persistent_state) {
+		// A new Dictionary each time, so the snapshot never holds a full copy of the state
+		return snapshots[handle].persistent_state.build_dictionary();
+	}
+	return snapshots[handle].state;
+}
+
+void PlannerSolutionGraph::save_persistent_snapshot(int p_node_id, const PlannerPersistentState &p_state) {
+	int handle = _allocate_snapshot(p_node_id);
+	snapshots[handle].persistent_state = p_state;
+	snapshots[handle].has_persistent_state = true;
+}
+
+const PlannerPersistentState *PlannerSolutionGraph::get_persistent_snapshot(int p_node_id) const {
+	int handle = node_snapshots[p_node_id];
+	if (handle < 0 || !snapshots[handle].has_persistent_state) {
+		return nullptr;
+	}
+	return &snapshots[handle].persistent_state;
+}
+
+void PlannerSolutionGraph::save_state_hash(int p_node_id, uint64_t p_state_hash) {
+	int handle = _allocate_snapshot(p_node_id);
+	snapshots[handle].state_hash = p_state_hash;
+}
+
+uint64_t PlannerSolutionGraph::get_state_hash(int p_node_id) const {
+	int handle = node_snapshots[p_node_id];
+	if (handle < 0) {
+		return 0;
+	}
+	return snapshots[handle].state_hash;
+}
+
+void PlannerSolutionGraph::save_stn_snapshot(int p_node_id, const PlannerSTNSolver::Snapshot &p_snapshot) {
+	int handle = _allocate_snapshot(p_node_id);
+	snapshots[handle].stn = p_snapshot;
+	snapshots[handle].has_stn = true;
+}
+
+const PlannerSTNSolver::Snapshot *PlannerSolutionGraph::get_stn_snapshot(int p_node_id) const {
+	int handle = node_snapshots[p_node_id];
+	if (handle < 0 || !snapshots[handle].has_stn) {
+		return nullptr;
+	}
+	return &snapshots[handle].stn;
+}
+
+void PlannerSolutionGraph::record_state_change(const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value) {
+	StateChange change;
+	change.variable = p_variable;
+	if (p_argument) {
+		change.argument = *p_argument;
+		change.nested = true;
+	}
+	if (p_old_value) {
+		change.old_value = *p_old_value;
+	} else {
+		change.existed = false;
+	}
+	state_trail.push_back(change);
+}
+
+void PlannerSolutionGraph::undo_state_changes(Dictionary &r_state, int p_trail_size) {
+	ERR_FAIL_INDEX(p_trail_size, (int)state_trail.size() + 1);
+	for (int i = (int)state_trail.size() - 1; i >= p_trail_size; i--) {
+		const StateChange &change = state_trail[i];
+		if (change.nested) {
+			Dictionary arguments = r_state[change.variable];
+			if (change.existed) {
+				arguments[change.argument] = change.old_value;
+			} else {
+				arguments.erase(change.argument);
+			}
+		} else if (change.existed) {
+			r_state[change.variable] = change.old_value;
+		} else {
+			r_state.erase(change.variable);
+		}
+	}
+	state_trail.resize(p_trail_size);
+}
+
+void PlannerSolutionGraph::save_trail_mark(int p_node_id, int p_trail_size) {
+	int handle = _allocate_snapshot(p_node_id);
+	snapshots[handle].trail_mark = p_trail_size;
+}
+
+int PlannerSolutionGraph::get_trail_mark(int p_node_id) const {
+	int handle = node_snapshots[p_node_id];
+	if (handle < 0) {
+		return -1;
+	}
+	return snapshots[handle].trail_mark;
+}
+
+void PlannerSolutionGraph::save_stn_level(int p_node_id, int p_level) {
+	int handle = _allocate_snapshot(p_node_id);
+	snapshots[handle].stn_level = p_level;
+}
+
+int PlannerSolutionGraph::get_stn_level(int p_node_id) const {
+	int handle = node_snapshots[p_node_id];
+	if (handle < 0) {
+		return -1;
+	}
+	return snapshots[handle].stn_level;
+}
+
+Dictionary PlannerSolutionGraph::get_node(int p_node_id) const {
+	Dictionary node;
+	ERR_FAIL_COND_V(!has_node(p_node_id), node);
+	node["type"] = static_cast<int>(node_types[p_node_id]);
+	node["status"] = static_cast<int>(node_statuses[p_node_id]);
+	node["info"] = node_infos[p_node_id];
+	node["parent"] = node_parents[p_node_id];
+	node["successors"] = get_successors(p_node_id);
+	node["state"] = get_state_snapshot(p_node_id);
+	node["selected_method"] = node_selected_methods[p_node_id] >= 0 ? Variant(get_selected_method(p_node_id)) : Variant();
+	node["available_methods"] = node_available_methods[p_node_id];
+	node["action"] = node_actions[p_node_id];
+	node["start_time"] = node_start_times[p_node_id];
+	node["end_time"] = node_end_times[p_node_id];
+	node["duration"] = node_durations[p_node_id];
+	return node;
+}
+
+Dictionary PlannerSolutionGraph::to_dictionary() const {
+	Dictionary graph;
+	for (uint32_t node_id = 0; node_id < node_types.size(); node_id++) {
+		if (node_alive[node_id]) {
+			graph[(int)node_id] = get_node(node_id);
+		}
+	}
+	return graph;
+}
@@ -33,11 +33,15 @@
 // SPDX-FileCopyrightText: 2025-present K. S. Ernest (iFire) Lee
 // SPDX-License-Identifier: MIT
 
+#include "core/templates/local_vector.h"
 #include "core/variant/callable.h"
 #include "core/variant/dictionary.h"
 #include "core/variant/typed_array.h"
 #include "core/variant/variant.h"
 
+#include "planner_persistent_state.h"
+#include "stn_solver.h"
+
 // Node types matching Elixir planner
 enum class PlannerNodeType {
 	TYPE_ROOT = 0, // :D - Root node
@@ -57,96 +61,141 @@ enum class PlannerNodeStatus {
 	STATUS_NOT_APPLICABLE = 3 // :NA - Not applicable
 };
 
+// Solution graph stored as a struct of arrays.
+// A node id is an index into every column below. Removed nodes are marked dead
+// and their ids are never reused, matching the Dictionary-keyed graph it replaces.
 class PlannerSolutionGraph {
 public:
-	// Solution graph: Dictionary<int, Dictionary> where key is node_id
-	Dictionary graph;
-	int next_node_id;
-
-	PlannerSolutionGraph() {
-		graph = Dictionary();
-		next_node_id = 0;
-		// Initialize root node (node 0)
-		Dictionary root_node;
-		root_node["type"] = static_cast<int>(PlannerNodeType::TYPE_ROOT);
-		root_node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_NOT_APPLICABLE);
-		root_node["info"] = Variant("root");
-		root_node["successors"] = TypedArray<int>();
-		root_node["state"] = Dictionary();
-		root_node["selected_method"] = Variant();
-		root_node["available_methods"] = TypedArray<Callable>();
-		root_node["action"] = Variant();
-		root_node["start_time"] = Variant(static_cast<int64_t>(0));
-		root_node["end_time"] = Variant(static_cast<int64_t>(0));
-		root_node["duration"] = Variant(static_cast<int64_t>(0));
-		graph[0] = root_node;
-		next_node_id = 1;
-	}
+	static constexpr int NO_NODE = -1;
+
+	// State and STN saved on the first visit of a node, restored when the search comes back to it.
+	struct NodeSnapshot {
+		Dictionary state; // Read-only copy, so methods can keep writing to the live state
+		PlannerPersistentState persistent_state; // Used instead of state when has_persistent_state
+		bool has_persistent_state = false;
+		PlannerSTNSolver::Snapshot stn;
+		bool has_stn = false;
+		int trail_mark = -1; // State trail length on the first visit, used instead of state in trail mode
+		int stn_level = -1; // STN undo levels open before the first visit, used instead of stn in trail mode
+		uint64_t state_hash = 0;
+	};
+
+	// One entry of the state trail: the value a state variable, or one argument
+	// of it, held before an action changed it.
+	struct StateChange {
+		Variant variable;
+		Variant argument; // Ignored unless nested
+		Variant old_value;
+		bool nested = false;
+		bool existed = true; // False if the action added the key
+	};
+
+private:
+	// Hot columns, read on every planner iteration.
+	LocalVector<uint8_t> node_types; // PlannerNodeType
+	LocalVector<uint8_t> node_statuses; // PlannerNodeStatus
+	LocalVector<uint8_t> node_alive;
+	LocalVector<int> node_parents;
+	LocalVector<int> node_depths; // Decomposition depth, 0 for the root
+	LocalVector<int> node_first_children;
+	LocalVector<int> node_last_children;
+	LocalVector<int> node_next_siblings;
+	LocalVector<int> node_selected_methods; // Index into the node's available methods, -1 if none
+	LocalVector<int> node_snapshots; // Handle into snapshots, -1 if the node was never visited
+
+	// Payload columns.
+	LocalVector<Variant> node_infos;
+	LocalVector<TypedArray<Callable>> node_available_methods;
+	LocalVector<Callable> node_actions;
+	LocalVector<int64_t> node_start_times;
+	LocalVector<int64_t> node_end_times;
+	LocalVector<int64_t> node_durations;
+
+	LocalVector<NodeSnapshot> snapshots;
+	LocalVector<int> free_snapshots;
+
+	LocalVector<StateChange> state_trail;
+
+	int node_count = 0;
+
+	int _allocate_snapshot(int p_node_id);
+	void _release_snapshot(int p_node_id);
+
+public:
+	PlannerSolutionGraph();
 
 	// Create a new node and return its ID
-	int create_node(PlannerNodeType p_type, Variant p_info, TypedArray<Callable> p_available_methods = TypedArray<Callable>(), Callable p_action = Callable()) {
-		int node_id = next_node_id++;
-		Dictionary node;
-		node["type"] = static_cast<int>(p_type);
-		node["status"] = static_cast<int>(PlannerNodeStatus::STATUS_OPEN);
-		node["info"] = p_info;
-		node["successors"] = TypedArray<int>();
-		node["state"] = Dictionary();
-		node["selected_method"] = Variant();
-		node["available_methods"] = p_available_methods;
-		node["action"] = p_action;
-		node["start_time"] = Variant(static_cast<int64_t>(0));
-		node["end_time"] = Variant(static_cast<int64_t>(0));
-		node["duration"] = Variant(static_cast<int64_t>(0));
-		graph[node_id] = node;
-		return node_id;
-	}
+	int create_node(PlannerNodeType p_type, const Variant &p_info, const TypedArray<Callable> &p_available_methods = TypedArray<Callable>(), const Callable &p_action = Callable());
 
-	// Get node by ID
-	Dictionary get_node(int p_node_id) const {
-		return graph[p_node_id];
-	}
+	// Link p_child_id as the last successor of p_parent_id
+	void add_successor(int p_parent_id, int p_child_id);
 
-	// Update node
-	void update_node(int p_node_id, Dictionary p_node) {
-		graph[p_node_id] = p_node;
-	}
+	// Mark a node as removed and drop its payload; its id stays reserved
+	void remove_node(int p_node_id);
 
-	// Get graph Dictionary (for graph operations that need direct access)
-	Dictionary &get_graph() {
-		return graph;
-	}
+	// Detach all successors of a node (does not remove them)
+	void clear_successors(int p_node_id);
 
-	// Add successor to a node
-	void add_successor(int p_parent_id, int p_child_id) {
-		Dictionary parent = graph[p_parent_id];
-		TypedArray<int> successors = parent["successors"];
-		successors.push_back(p_child_id);
-		parent["successors"] = successors;
-		graph[p_parent_id] = parent;
+	_FORCE_INLINE_ int get_next_node_id() const { return node_types.size(); }
+	_FORCE_INLINE_ int get_node_count() const { return node_count; }
+	_FORCE_INLINE_ bool has_node(int p_node_id) const {
+		return p_node_id >= 0 && p_node_id < (int)node_alive.size() && node_alive[p_node_id];
 	}
 
-	// Set node status
-	void set_node_status(int p_node_id, PlannerNodeStatus p_status) {
-		Dictionary node = graph[p_node_id];
-		node["status"] = static_cast<int>(p_status);
-		graph[p_node_id] = node;
-	}
+	_FORCE_INLINE_ PlannerNodeType get_node_type(int p_node_id) const { return static_cast<PlannerNodeType>(node_types[p_node_id]); }
+	_FORCE_INLINE_ PlannerNodeStatus get_node_status(int p_node_id) const { return static_cast<PlannerNodeStatus>(node_statuses[p_node_id]); }
+	_FORCE_INLINE_ void set_node_status(int p_node_id, PlannerNodeStatus p_status) { node_statuses[p_node_id] = static_cast<uint8_t>(p_status); }
+	_FORCE_INLINE_ int get_parent(int p_node_id) const { return node_parents[p_node_id]; }
+	_FORCE_INLINE_ int get_node_depth(int p_node_id) const { return node_depths[p_node_id]; }
+	_FORCE_INLINE_ int get_first_successor(int p_node_id) const { return node_first_children[p_node_id]; }
+	_FORCE_INLINE_ int get_next_sibling(int p_node_id) const { return node_next_siblings[p_node_id]; }
+	_FORCE_INLINE_ int get_selected_method_index(int p_node_id) const { return node_selected_methods[p_node_id]; }
+	_FORCE_INLINE_ void set_selected_method_index(int p_node_id, int p_method_index) { node_selected_methods[p_node_id] = p_method_index; }
 
-	// Save state snapshot at node
-	void save_state_snapshot(int p_node_id, Dictionary p_state) {
-		Dictionary node = graph[p_node_id];
-		node["state"] = p_state.duplicate();
-		graph[p_node_id] = node;
-	}
+	_FORCE_INLINE_ const Variant &get_node_info(int p_node_id) const { return node_infos[p_node_id]; }
+	_FORCE_INLINE_ const TypedArray<Callable> &get_available_methods(int p_node_id) const { return node_available_methods[p_node_id]; }
+	_FORCE_INLINE_ void set_available_methods(int p_node_id, const TypedArray<Callable> &p_methods) { node_available_methods[p_node_id] = p_methods; }
+	_FORCE_INLINE_ const Callable &get_action(int p_node_id) const { return node_actions[p_node_id]; }
+	Callable get_selected_method(int p_node_id) const;
 
-	// Get state snapshot from node
-	Dictionary get_state_snapshot(int p_node_id) const {
-		Dictionary node = graph[p_node_id];
-		Dictionary state = node["state"];
-		if (state.is_empty()) {
-			return Dictionary();
-		}
-		return state.duplicate();
-	}
+	void set_action_times(int p_node_id, int64_t p_start_time, int64_t p_end_time, int64_t p_duration);
+	_FORCE_INLINE_ int64_t get_start_time(int p_node_id) const { return node_start_times[p_node_id]; }
+	_FORCE_INLINE_ int64_t get_end_time(int p_node_id) const { return node_end_times[p_node_id]; }
+	_FORCE_INLINE_ int64_t get_duration(int p_node_id) const { return node_durations[p_node_id]; }
+
+	TypedArray<int> get_successors(int p_node_id) const;
+
+	// Snapshots
+	_FORCE_INLINE_ bool has_snapshot(int p_node_id) const { return node_snapshots[p_node_id] >= 0; }
+	// A state snapshot is the state Dictionary itself, not a copy. The planner copies its
+	// live state before a method may write to it while a snapshot holds it; other callers
+	// that need to write must duplicate() first.
+	void save_state_snapshot(int p_node_id, const Dictionary &p_state);
+	Dictionary get_state_snapshot(int p_node_id) const;
+	// A persistent version shares its unchanged variables with the other nodes' versions,
+	// so saving one copies a pointer. get_state_snapshot() builds a new
+	// Dictionary from it on each call, which reads every entry.
+	void save_persistent_snapshot(int p_node_id, const PlannerPersistentState &p_state);
+	const PlannerPersistentState *get_persistent_snapshot(int p_node_id) const; // nullptr if none was saved
+	void save_state_hash(int p_node_id, uint64_t p_state_hash);
+	uint64_t get_state_hash(int p_node_id) const; // 0 if none was saved
+	void save_stn_snapshot(int p_node_id, const PlannerSTNSolver::Snapshot &p_snapshot);
+	const PlannerSTNSolver::Snapshot *get_stn_snapshot(int p_node_id) const; // nullptr if none was saved
+
+	// State trail. Instead of a state per node, record what each action changed
+	// and undo it in place when the search returns to an earlier node.
+	// Relies on actions replacing the nested dictionaries they change instead of
+	// editing them in place, as PlannerDomain::add_actions() documents.
+	_FORCE_INLINE_ int get_state_trail_size() const { return state_trail.size(); }
+	// Records one change reported by planner_for_each_state_change()
+	void record_state_change(const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value);
+	void undo_state_changes(Dictionary &r_state, int p_trail_size);
+	void save_trail_mark(int p_node_id, int p_trail_size);
+	int get_trail_mark(int p_node_id) const; // -1 if none was saved
+	void save_stn_level(int p_node_id, int p_level);
+	int get_stn_level(int p_node_id) const; // -1 if none was saved
+
+	// Dictionary views for debugging, GDScript and tests
+	Dictionary get_node(int p_node_id) const;
+	Dictionary to_dictionary() const;
 };
@@ -169,6 +169,12 @@ bool PlannerSTNConstraints::add_temporal_relation(PlannerSTNSolver &p_stn, const
 bool PlannerSTNConstraints::anchor_to_origin(PlannerSTNSolver &p_stn, const String &p_point, int64_t p_absolute_time) {
 	ensure_origin(p_stn);
 
+	// The origin is the reference every distance is measured from; a self edge
+	// with a nonzero weight would be a negative cycle
+	if (p_point == "origin") {
+		return true;
+	}
+
 	// Add constraint: origin -> point: {absolute_time, absolute_time}
 	return p_stn.add_constraint("origin", p_point, p_absolute_time, p_absolute_time);
 }
@@ -56,7 +56,7 @@ public:
 	static bool add_temporal_relation(PlannerSTNSolver &p_stn, const String &p_from, const String &p_to, const String &p_relation);
 
 	// Anchor a time point to absolute time (relative to origin)
-	// If origin doesn't exist, creates it
+	// If origin doesn't exist, creates it. Anchoring the origin itself adds nothing
 	static bool anchor_to_origin(PlannerSTNSolver &p_stn, const String &p_point, int64_t p_absolute_time);
 
 private:
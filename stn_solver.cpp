@@ -29,12 +29,161 @@
 /**************************************************************************/
 
 #include "stn_solver.h"
+#include "core/error/error_macros.h"
+#include "core/os/memory.h"
 #include "core/string/print_string.h"
 #include "core/variant/array.h"
 #include "core/variant/dictionary.h"
 
+// The AVX2 path is built with a target attribute and picked at run time, so it doesn't
+// need the whole build to use -mavx2
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define STN_AVX2_TARGET __attribute__((target("avx2")))
+#define STN_HAS_AVX2() __builtin_cpu_supports("avx2")
+#elif defined(__AVX2__)
+#define STN_AVX2_TARGET
+#define STN_HAS_AVX2() true
+#endif
+
+#if defined(STN_HAS_AVX2) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
 constexpr int64_t PlannerSTNSolver::STN_INFINITY;
 constexpr int64_t PlannerSTNSolver::STN_NEG_INFINITY;
+constexpr uint32_t PlannerSTNSolver::MATRIX_ALIGN;
+
+static constexpr size_t CELL_BUFFER_ALIGNMENT = 64; // MATRIX_ALIGN cells
+
+#ifdef STN_HAS_AVX2
+// Relaxes cells [0, p_count) four at a time; both rows must start on a 32-byte boundary.
+STN_AVX2_TARGET static void relax_row_avx2(int64_t *r_row, const int64_t *p_via, int64_t p_dist, uint32_t p_count) {
+	const __m256i inf_v = _mm256_set1_epi64x(INT64_MAX);
+	const __m256i neg_inf_v = _mm256_set1_epi64x(INT64_MIN + 1);
+	const __m256i zero_v = _mm256_setzero_si256();
+	const __m256i dist_v = _mm256_set1_epi64x(p_dist);
+	for (uint32_t j = 0; j < p_count; j += 4) {
+		__m256i via = _mm256_load_si256((const __m256i *)(p_via + j));
+		__m256i cur = _mm256_load_si256((const __m256i *)(r_row + j));
+		__m256i sum = _mm256_add_epi64(dist_v, via);
+		if (p_dist > 0) {
+			__m256i overflow = _mm256_and_si256(_mm256_cmpgt_epi64(via, zero_v), _mm256_cmpgt_epi64(dist_v, sum));
+			sum = _mm256_blendv_epi8(sum, inf_v, overflow);
+		} else if (p_dist < 0) {
+			// A sum of exactly INT64_MIN does not wrap but still lies below negative infinity
+			__m256i wrapped = _mm256_or_si256(_mm256_cmpgt_epi64(sum, dist_v), _mm256_cmpgt_epi64(neg_inf_v, sum));
+			__m256i underflow = _mm256_and_si256(_mm256_cmpgt_epi64(zero_v, via), wrapped);
+			sum = _mm256_blendv_epi8(sum, neg_inf_v, underflow);
+		}
+		__m256i shorter = _mm256_andnot_si256(_mm256_cmpeq_epi64(via, inf_v), _mm256_cmpgt_epi64(cur, sum));
+		_mm256_store_si256((__m256i *)(r_row + j), _mm256_blendv_epi8(cur, sum, shorter));
+	}
+}
+#endif
+
+// Min-plus relaxation of one matrix row: r_row[j] = min(r_row[j], p_dist + p_via[j]), with the sum
+// saturating like PlannerSTNSolver::add_distances(). Cells where p_via is infinite are left alone.
+// Both rows come from CellBuffers and p_count must be a multiple of MATRIX_ALIGN; p_via may alias r_row.
+static void relax_row(int64_t *r_row, const int64_t *p_via, int64_t p_dist, uint32_t p_count) {
+	const int64_t inf = INT64_MAX;
+	const int64_t neg_inf = INT64_MIN + 1;
+	uint32_t j = 0;
+
+#ifdef STN_HAS_AVX2
+	static const bool has_avx2 = STN_HAS_AVX2();
+	if (has_avx2) {
+		relax_row_avx2(r_row, p_via, p_dist, p_count);
+		return;
+	}
+#endif
+#if defined(__SSE4_2__)
+	const __m128i inf_v = _mm_set1_epi64x(inf);
+	const __m128i neg_inf_v = _mm_set1_epi64x(neg_inf);
+	const __m128i zero_v = _mm_setzero_si128();
+	const __m128i dist_v = _mm_set1_epi64x(p_dist);
+	for (; j < p_count; j += 2) {
+		__m128i via = _mm_load_si128((const __m128i *)(p_via + j));
+		__m128i cur = _mm_load_si128((const __m128i *)(r_row + j));
+		__m128i sum = _mm_add_epi64(dist_v, via);
+		if (p_dist > 0) {
+			__m128i overflow = _mm_and_si128(_mm_cmpgt_epi64(via, zero_v), _mm_cmpgt_epi64(dist_v, sum));
+			sum = _mm_blendv_epi8(sum, inf_v, overflow);
+		} else if (p_dist < 0) {
+			__m128i wrapped = _mm_or_si128(_mm_cmpgt_epi64(sum, dist_v), _mm_cmpgt_epi64(neg_inf_v, sum));
+			__m128i underflow = _mm_and_si128(_mm_cmpgt_epi64(zero_v, via), wrapped);
+			sum = _mm_blendv_epi8(sum, neg_inf_v, underflow);
+		}
+		__m128i shorter = _mm_andnot_si128(_mm_cmpeq_epi64(via, inf_v), _mm_cmpgt_epi64(cur, sum));
+		_mm_store_si128((__m128i *)(r_row + j), _mm_blendv_epi8(cur, sum, shorter));
+	}
+#endif
+
+	for (; j < p_count; j++) {
+		int64_t via = p_via[j];
+		if (via == inf) {
+			continue; // Can't reach j from the via point
+		}
+		int64_t sum = (int64_t)((uint64_t)p_dist + (uint64_t)via);
+		if (p_dist > 0 && via > 0 && sum < p_dist) {
+			sum = inf; // Overflow, treat as infinity
+		} else if (p_dist < 0 && via < 0 && (sum > p_dist || sum < neg_inf)) {
+			sum = neg_inf; // Underflow
+		}
+		if (sum < r_row[j]) {
+			r_row[j] = sum;
+		}
+	}
+}
+
+void PlannerSTNSolver::CellBuffer::resize(uint32_t p_count) {
+	if (p_count == count) {
+		return;
+	}
+	if (p_count == 0) {
+		clear();
+		return;
+	}
+	cells = (int64_t *)Memory::realloc_aligned_static(cells, sizeof(int64_t) * p_count, sizeof(int64_t) * count, CELL_BUFFER_ALIGNMENT);
+	count = p_count;
+}
+
+void PlannerSTNSolver::CellBuffer::clear() {
+	if (cells) {
+		Memory::free_aligned_static(cells);
+		cells = nullptr;
+	}
+	count = 0;
+}
+
+PlannerSTNSolver::CellBuffer::CellBuffer(const CellBuffer &p_other) {
+	*this = p_other;
+}
+
+PlannerSTNSolver::CellBuffer::CellBuffer(CellBuffer &&p_other) {
+	*this = std::move(p_other);
+}
+
+PlannerSTNSolver::CellBuffer &PlannerSTNSolver::CellBuffer::operator=(const CellBuffer &p_other) {
+	if (this != &p_other) {
+		clear();
+		resize(p_other.count);
+		if (count > 0) {
+			memcpy(cells, p_other.cells, sizeof(int64_t) * count);
+		}
+	}
+	return *this;
+}
+
+PlannerSTNSolver::CellBuffer &PlannerSTNSolver::CellBuffer::operator=(CellBuffer &&p_other) {
+	if (this != &p_other) {
+		clear();
+		cells = p_other.cells;
+		count = p_other.count;
+		p_other.cells = nullptr;
+		p_other.count = 0;
+	}
+	return *this;
+}
 
 PlannerSTNSolver::PlannerSTNSolver() {
 	consistent = true;
@@ -58,26 +207,52 @@ void PlannerSTNSolver::ensure_time_point(const String &p_name) {
 		int64_t index = next_time_point_id++;
 		time_points_map_internal[p_name] = index;
 		time_points_list_internal.push_back(p_name);
+		revision++;
 
-		// Expand distance matrix to accommodate new point
-		// Initialize with STN_INFINITY for all distances except self (0)
-		uint32_t current_size = time_points_list_internal.size();
-		distance_matrix_internal.resize(current_size);
+		resize_distance_matrix(time_points_list_internal.size());
+	}
+}
 
-		for (uint32_t i = 0; i < current_size; i++) {
-			if (distance_matrix_internal[i].size() < current_size) {
-				distance_matrix_internal[i].resize(current_size);
+void PlannerSTNSolver::resize_distance_matrix(uint32_t p_size) {
+	// New points have no constraints yet, so they are unreachable from every other point
+	// and the existing distances stay valid
+	uint32_t old_size = matrix_size;
+	if (p_size > matrix_stride) {
+		// Grow geometrically so adding points one at a time doesn't copy the matrix each time
+		uint32_t new_stride = (p_size + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+		new_stride = MAX(new_stride, matrix_stride * 2);
+		CellBuffer grown;
+		grown.resize(new_stride * new_stride);
+		for (uint32_t i = 0; i < old_size; i++) {
+			memcpy(grown.ptr() + i * new_stride, distance_matrix_internal.ptr() + i * matrix_stride, sizeof(int64_t) * old_size);
+			for (uint32_t j = old_size; j < new_stride; j++) {
+				grown[i * new_stride + j] = STN_INFINITY;
 			}
+		}
+		if (is_recording()) {
+			image_trail.push_back(MatrixImage());
+			MatrixImage &image = image_trail[image_trail.size() - 1];
+			image.cells = std::move(distance_matrix_internal);
+			image.stride = matrix_stride;
+			image.cell_trail_size = cell_trail.size();
+		}
+		distance_matrix_internal = std::move(grown);
+		matrix_stride = new_stride;
+	}
 
-			for (uint32_t j = 0; j < current_size; j++) {
-				if (i == j) {
-					distance_matrix_internal[i][j] = 0; // Distance to self is 0
-				} else if (j >= distance_matrix_internal[i].size() - 1) {
-					distance_matrix_internal[i][j] = STN_INFINITY; // New point, initialize to infinity
-				}
-			}
+	for (uint32_t i = 0; i < old_size; i++) {
+		for (uint32_t j = old_size; j < p_size; j++) {
+			distance(i, j) = STN_INFINITY;
 		}
 	}
+	for (uint32_t i = old_size; i < p_size; i++) {
+		int64_t *row = &distance(i, 0);
+		for (uint32_t j = 0; j < matrix_stride; j++) {
+			row[j] = STN_INFINITY;
+		}
+		row[i] = 0; // Distance to self is 0
+	}
+	matrix_size = p_size;
 }
 
 PlannerSTNSolver::Constraint PlannerSTNSolver::intersect_constraints(const Constraint &p_a, const Constraint &p_b) const {
@@ -95,52 +270,29 @@ PlannerSTNSolver::Constraint PlannerSTNSolver::intersect_constraints(const Const
 
 void PlannerSTNSolver::rebuild_distance_matrix() {
 	uint32_t n = time_points_list_internal.size();
-	distance_matrix_internal.clear();
-	distance_matrix_internal.resize(n);
-
-	// Initialize distance matrix
-	for (uint32_t i = 0; i < n; i++) {
-		LocalVector<int64_t> row;
-		row.resize(n);
-		for (uint32_t j = 0; j < n; j++) {
-			if (i == j) {
-				row[j] = 0;
-			} else {
-				row[j] = STN_INFINITY;
-			}
-		}
-		distance_matrix_internal[i] = row;
-	}
+	matrix_size = 0;
+	resize_distance_matrix(n);
 
 	// Add constraints to distance matrix
-	for (const KeyValue<String, Constraint> &E : constraints_map_internal) {
-		String key = E.key;
-		Constraint constraint = E.value;
+	for (const KeyValue<uint64_t, Constraint> &E : constraints_map_internal) {
+		uint32_t from_idx = E.key >> 32;
+		uint32_t to_idx = E.key & 0xFFFFFFFF;
+		const Constraint &constraint = E.value;
 
-		// Parse key: "from:to"
-		int colon_pos = key.find(":");
-		if (colon_pos < 0) {
-			continue;
-		}
-		String from = key.substr(0, colon_pos);
-		String to = key.substr(colon_pos + 1);
-
-		int64_t from_idx = get_time_point_index(from);
-		int64_t to_idx = get_time_point_index(to);
-
-		if (from_idx < 0 || to_idx < 0 || from_idx >= (int64_t)n || to_idx >= (int64_t)n) {
+		if (from_idx >= n || to_idx >= n) {
 			continue;
 		}
 
 		// Set distance to max (temporal constraint: to - from <= max)
-		int64_t current_dist = distance_matrix_internal[from_idx][to_idx];
+		int64_t &current_dist = distance(from_idx, to_idx);
 		if (current_dist == STN_INFINITY || constraint.max_distance < current_dist) {
-			distance_matrix_internal[from_idx][to_idx] = constraint.max_distance;
+			current_dist = constraint.max_distance;
 		}
 	}
 }
 
 void PlannerSTNSolver::run_floyd_warshall() {
+	revision++;
 	uint32_t n = time_points_list_internal.size();
 	if (n == 0) {
 		consistent = true;
@@ -148,39 +300,21 @@ void PlannerSTNSolver::run_floyd_warshall() {
 	}
 
 	// Ensure distance matrix is built
-	if (distance_matrix_internal.size() != n) {
+	if (matrix_size != n) {
 		rebuild_distance_matrix();
 	}
 
 	// Floyd-Warshall algorithm: all-pairs shortest paths
+	uint32_t count = (n + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN; // Padding cells stay infinite
 	for (uint32_t k = 0; k < n; k++) {
+		const int64_t *row_k = &distance(k, 0);
 		for (uint32_t i = 0; i < n; i++) {
-			int64_t dist_ik = distance_matrix_internal[i][k];
-
+			int64_t *row_i = &distance(i, 0);
+			int64_t dist_ik = row_i[k];
 			if (dist_ik == STN_INFINITY) {
 				continue; // Can't reach k from i
 			}
-
-			for (uint32_t j = 0; j < n; j++) {
-				int64_t dist_kj = distance_matrix_internal[k][j];
-				if (dist_kj == STN_INFINITY) {
-					continue; // Can't reach j from k
-				}
-
-				int64_t dist_ij = distance_matrix_internal[i][j];
-				int64_t new_dist = dist_ik + dist_kj;
-
-				// Check for overflow
-				if (dist_ik > 0 && dist_kj > 0 && new_dist < dist_ik) {
-					new_dist = STN_INFINITY; // Overflow, treat as infinity
-				} else if (dist_ik < 0 && dist_kj < 0 && new_dist > dist_ik) {
-					new_dist = STN_NEG_INFINITY; // Underflow
-				}
-
-				if (new_dist < dist_ij) {
-					distance_matrix_internal[i][j] = new_dist;
-				}
-			}
+			relax_row(row_i, row_k, dist_ik, count);
 		}
 	}
 
@@ -188,12 +322,62 @@ void PlannerSTNSolver::run_floyd_warshall() {
 	consistent = !check_negative_cycles();
 }
 
-bool PlannerSTNSolver::check_negative_cycles() const {
-	uint32_t n = time_points_list_internal.size();
+int64_t PlannerSTNSolver::add_distances(int64_t p_a, int64_t p_b) {
+	if (p_a == STN_INFINITY || p_b == STN_INFINITY) {
+		return STN_INFINITY;
+	}
+	int64_t sum = (int64_t)((uint64_t)p_a + (uint64_t)p_b);
+	// Saturate like run_floyd_warshall() does
+	if (p_a > 0 && p_b > 0 && sum < p_a) {
+		return STN_INFINITY;
+	} else if (p_a < 0 && p_b < 0 && (sum > p_a || sum < STN_NEG_INFINITY)) {
+		return STN_NEG_INFINITY;
+	}
+	return sum;
+}
 
-	// Negative cycle exists if distance[i][i] < 0 for any i
+void PlannerSTNSolver::propagate_edge(uint32_t p_from, uint32_t p_to, int64_t p_weight) {
+	// Incremental all-pairs shortest paths: the only paths a new or tightened edge
+	// can shorten are i -> from -> to -> j, so one O(n^2) pass keeps the matrix closed
+	if (p_weight >= distance(p_from, p_to)) {
+		return;
+	}
+	uint32_t n = matrix_size;
+	uint32_t count = (n + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+
+	// Copy the column into p_from and the row out of p_to; a negative cycle would change them mid-pass
+	LocalVector<int64_t> to_from;
+	to_from.resize(n);
 	for (uint32_t i = 0; i < n; i++) {
-		int64_t self_dist = distance_matrix_internal[i][i];
+		to_from[i] = add_distances(distance(i, p_from), p_weight);
+	}
+	CellBuffer from_to;
+	from_to.resize(count);
+	memcpy(from_to.ptr(), &distance(p_to, 0), sizeof(int64_t) * count);
+
+	bool recording = is_recording();
+	if (recording) {
+		trail_scratch.resize(count);
+	}
+	for (uint32_t i = 0; i < n; i++) {
+		if (to_from[i] == STN_INFINITY) {
+			continue; // Can't reach the new edge from i
+		}
+		int64_t *row = &distance(i, 0);
+		if (recording) {
+			memcpy(trail_scratch.ptr(), row, sizeof(int64_t) * count);
+		}
+		relax_row(row, from_to.ptr(), to_from[i], count);
+		if (recording) {
+			record_cells(i * matrix_stride, trail_scratch.ptr(), count);
+		}
+	}
+}
+
+bool PlannerSTNSolver::check_negative_cycles() const {
+	// Negative cycle exists if distance[i][i] < 0 for any i
+	for (uint32_t i = 0; i < matrix_size; i++) {
+		int64_t self_dist = distance(i, i);
 		if (self_dist < 0) {
 			return true; // Negative cycle detected
 		}
@@ -226,6 +410,8 @@ bool PlannerSTNSolver::add_constraint(const String &p_from, const String &p_to,
 }
 
 bool PlannerSTNSolver::add_constraint(const String &p_from, const String &p_to, const Constraint &p_constraint) {
+	revision++;
+
 	// Ensure time points exist
 	ensure_time_point(p_from);
 	ensure_time_point(p_to);
@@ -236,8 +422,10 @@ bool PlannerSTNSolver::add_constraint(const String &p_from, const String &p_to,
 		return false;
 	}
 
-	String forward_key = p_from + ":" + p_to;
-	String reverse_key = p_to + ":" + p_from;
+	uint32_t from_idx = get_time_point_index(p_from);
+	uint32_t to_idx = get_time_point_index(p_to);
+	uint64_t forward_key = edge_key(from_idx, to_idx);
+	uint64_t reverse_key = edge_key(to_idx, from_idx);
 
 	// Get existing constraints if any
 	Constraint forward_constraint = p_constraint;
@@ -267,41 +455,66 @@ bool PlannerSTNSolver::add_constraint(const String &p_from, const String &p_to,
 	}
 
 	// Store constraints in internal HashMap
+	record_edge(forward_key);
+	record_edge(reverse_key);
 	constraints_map_internal[forward_key] = forward_constraint;
 	constraints_map_internal[reverse_key] = reverse_constraint;
 
-	// Rebuild distance matrix and run Floyd-Warshall
-	rebuild_distance_matrix();
-	run_floyd_warshall();
+	// A consistent matrix already holds all shortest paths, so only the two edges need
+	// propagating. Otherwise rebuild, since the flag may come from a constraint that was rejected.
+	if (!consistent || matrix_size != time_points_list_internal.size()) {
+		begin_matrix_change();
+		rebuild_distance_matrix();
+		run_floyd_warshall();
+		end_matrix_change();
+		return consistent;
+	}
+	propagate_edge(from_idx, to_idx, forward_constraint.max_distance);
+	propagate_edge(to_idx, from_idx, reverse_constraint.max_distance);
+	consistent = !check_negative_cycles();
 
 	return consistent;
 }
 
 bool PlannerSTNSolver::remove_constraint(const String &p_from, const String &p_to) {
-	String forward_key = p_from + ":" + p_to;
-	String reverse_key = p_to + ":" + p_from;
+	int64_t from_idx = get_time_point_index(p_from);
+	int64_t to_idx = get_time_point_index(p_to);
+	if (from_idx < 0 || to_idx < 0) {
+		return false;
+	}
+	uint64_t forward_key = edge_key(from_idx, to_idx);
+	uint64_t reverse_key = edge_key(to_idx, from_idx);
 
 	bool removed = false;
 	if (constraints_map_internal.has(forward_key)) {
+		record_edge(forward_key);
 		constraints_map_internal.erase(forward_key);
 		removed = true;
 	}
 	if (constraints_map_internal.has(reverse_key)) {
+		record_edge(reverse_key);
 		constraints_map_internal.erase(reverse_key);
 		removed = true;
 	}
 
 	if (removed) {
+		revision++;
+		begin_matrix_change();
 		rebuild_distance_matrix();
 		run_floyd_warshall();
+		end_matrix_change();
 	}
 
 	return removed;
 }
 
 PlannerSTNSolver::Constraint PlannerSTNSolver::get_constraint(const String &p_from, const String &p_to) const {
-	String key = p_from + ":" + p_to;
-	const Constraint *constraint = constraints_map_internal.getptr(key);
+	int64_t from_idx = get_time_point_index(p_from);
+	int64_t to_idx = get_time_point_index(p_to);
+	if (from_idx < 0 || to_idx < 0) {
+		return Constraint(STN_INFINITY, STN_INFINITY); // Unknown point = unbounded
+	}
+	const Constraint *constraint = constraints_map_internal.getptr(edge_key(from_idx, to_idx));
 	if (constraint == nullptr) {
 		return Constraint(STN_INFINITY, STN_INFINITY); // No constraint = unbounded
 	}
@@ -309,27 +522,138 @@ PlannerSTNSolver::Constraint PlannerSTNSolver::get_constraint(const String &p_fr
 }
 
 bool PlannerSTNSolver::has_constraint(const String &p_from, const String &p_to) const {
-	String key = p_from + ":" + p_to;
-	return constraints_map_internal.has(key);
+	int64_t from_idx = get_time_point_index(p_from);
+	int64_t to_idx = get_time_point_index(p_to);
+	if (from_idx < 0 || to_idx < 0) {
+		return false;
+	}
+	return constraints_map_internal.has(edge_key(from_idx, to_idx));
 }
 
 void PlannerSTNSolver::check_consistency() {
+	begin_matrix_change();
 	run_floyd_warshall();
+	end_matrix_change();
+}
+
+void PlannerSTNSolver::record_edge(uint64_t p_key) {
+	if (!is_recording()) {
+		return;
+	}
+	EdgeChange change;
+	change.key = p_key;
+	const Constraint *existing = constraints_map_internal.getptr(p_key);
+	if (existing) {
+		change.old_constraint = *existing;
+		change.existed = true;
+	}
+	edge_trail.push_back(change);
+}
+
+void PlannerSTNSolver::record_cells(uint32_t p_first, const int64_t *p_before, uint32_t p_count) {
+	const int64_t *after = distance_matrix_internal.ptr() + p_first;
+	for (uint32_t i = 0; i < p_count; i++) {
+		if (after[i] != p_before[i]) {
+			cell_trail.push_back(Pair<uint32_t, int64_t>(p_first + i, p_before[i]));
+		}
+	}
+}
+
+void PlannerSTNSolver::begin_matrix_change() {
+	// Full recomputations touch every cell, so copy the matrix and record the difference afterwards
+	if (!is_recording()) {
+		return;
+	}
+	scratch_size = matrix_size;
+	scratch_stride = matrix_stride;
+	trail_scratch.resize(scratch_size * scratch_stride);
+	if (!trail_scratch.is_empty()) {
+		memcpy(trail_scratch.ptr(), distance_matrix_internal.ptr(), sizeof(int64_t) * trail_scratch.size());
+	}
+}
+
+void PlannerSTNSolver::end_matrix_change() {
+	if (!is_recording()) {
+		return;
+	}
+	if (matrix_stride != scratch_stride) {
+		return; // The matrix was reallocated before it changed, and the image trail holds the old one
+	}
+	record_cells(0, trail_scratch.ptr(), MIN(scratch_size, matrix_size) * matrix_stride);
+}
+
+void PlannerSTNSolver::discard_levels() {
+	levels.clear();
+	cell_trail.clear();
+	edge_trail.clear();
+	image_trail.clear();
+}
+
+void PlannerSTNSolver::push_level() {
+	Level level;
+	level.cell_trail_size = cell_trail.size();
+	level.edge_trail_size = edge_trail.size();
+	level.image_count = image_trail.size();
+	level.time_point_count = time_points_list_internal.size();
+	level.matrix_size = matrix_size;
+	level.consistent = consistent;
+	level.next_time_point_id = next_time_point_id;
+	levels.push_back(level);
+}
+
+void PlannerSTNSolver::pop_level() {
+	ERR_FAIL_COND_MSG(levels.is_empty(), "No STN level to pop.");
+	const Level level = levels[levels.size() - 1];
+	levels.resize(levels.size() - 1);
+
+	// Undo matrix cells newest first; cells recorded before a reallocation index the older buffer
+	uint32_t cell_index = cell_trail.size();
+	for (uint32_t i = image_trail.size(); i > level.image_count; i--) {
+		MatrixImage &image = image_trail[i - 1];
+		for (; cell_index > image.cell_trail_size; cell_index--) {
+			const Pair<uint32_t, int64_t> &cell = cell_trail[cell_index - 1];
+			distance_matrix_internal[cell.first] = cell.second;
+		}
+		distance_matrix_internal = std::move(image.cells);
+		matrix_stride = image.stride;
+	}
+	for (; cell_index > level.cell_trail_size; cell_index--) {
+		const Pair<uint32_t, int64_t> &cell = cell_trail[cell_index - 1];
+		distance_matrix_internal[cell.first] = cell.second;
+	}
+	cell_trail.resize(level.cell_trail_size);
+	image_trail.resize(level.image_count);
+	matrix_size = level.matrix_size;
+
+	for (uint32_t i = edge_trail.size(); i > level.edge_trail_size; i--) {
+		const EdgeChange &change = edge_trail[i - 1];
+		if (change.existed) {
+			constraints_map_internal[change.key] = change.old_constraint;
+		} else {
+			constraints_map_internal.erase(change.key);
+		}
+	}
+	edge_trail.resize(level.edge_trail_size);
+
+	for (uint32_t i = level.time_point_count; i < time_points_list_internal.size(); i++) {
+		time_points_map_internal.erase(time_points_list_internal[i]);
+	}
+	time_points_list_internal.resize(level.time_point_count);
+
+	consistent = level.consistent;
+	next_time_point_id = level.next_time_point_id;
+	revision++;
 }
 
 int64_t PlannerSTNSolver::get_distance(const String &p_from, const String &p_to) const {
 	int64_t from_idx = get_time_point_index(p_from);
 	int64_t to_idx = get_time_point_index(p_to);
 
-	if (from_idx < 0 || to_idx < 0 || from_idx >= (int64_t)distance_matrix_internal.size()) {
+	if (from_idx < 0 || to_idx < 0 || from_idx >= matrix_size || to_idx >= matrix_size) {
 		return STN_INFINITY;
 	}
 
-	if (to_idx >= (int64_t)distance_matrix_internal[from_idx].size()) {
-		return STN_INFINITY;
-	}
-
-	return distance_matrix_internal[from_idx][to_idx];
+	return distance(from_idx, to_idx);
 }
 
 int64_t PlannerSTNSolver::get_earliest_time(const String &p_point) const {
@@ -360,94 +684,126 @@ int64_t PlannerSTNSolver::get_latest_time(const String &p_point) const {
 }
 
 PlannerSTNSolver::Snapshot PlannerSTNSolver::create_snapshot() const {
-	Snapshot snapshot;
-
-	// Convert internal HashMap to Dictionary for serialization
-	Dictionary time_points_dict;
-	for (const KeyValue<String, int64_t> &E : time_points_map_internal) {
-		time_points_dict[E.key] = E.value;
+	// The planner snapshots on every first visit, mostly without touching the STN in between
+	if (cached_snapshot_revision == revision) {
+		return cached_snapshot;
 	}
-	snapshot.time_points_map = time_points_dict;
 
-	// Convert internal LocalVector to Array for serialization
-	Array time_points_array;
-	time_points_array.resize(time_points_list_internal.size());
+	Snapshot snapshot;
+	snapshot.time_points_list.resize(time_points_list_internal.size());
+	String *names = snapshot.time_points_list.ptrw();
 	for (uint32_t i = 0; i < time_points_list_internal.size(); i++) {
-		time_points_array[i] = time_points_list_internal[i];
+		names[i] = time_points_list_internal[i];
 	}
-	snapshot.time_points_list = time_points_array;
 
-	// Convert internal constraints HashMap to Dictionary for serialization
-	Dictionary constraints_dict;
-	for (const KeyValue<String, Constraint> &E : constraints_map_internal) {
-		Dictionary constraint_dict;
-		constraint_dict["min_distance"] = E.value.min_distance;
-		constraint_dict["max_distance"] = E.value.max_distance;
-		constraints_dict[E.key] = constraint_dict;
+	snapshot.edges.resize(constraints_map_internal.size());
+	Pair<uint64_t, Constraint> *edges = snapshot.edges.ptrw();
+	for (const KeyValue<uint64_t, Constraint> &E : constraints_map_internal) {
+		*edges++ = Pair<uint64_t, Constraint>(E.key, E.value);
 	}
-	snapshot.constraints_map = constraints_dict;
 
-	// Convert internal distance matrix to Array for serialization
-	Array matrix_copy;
-	matrix_copy.resize(distance_matrix_internal.size());
-	for (uint32_t i = 0; i < distance_matrix_internal.size(); i++) {
-		Array row;
-		row.resize(distance_matrix_internal[i].size());
-		for (uint32_t j = 0; j < distance_matrix_internal[i].size(); j++) {
-			row[j] = distance_matrix_internal[i][j];
-		}
-		matrix_copy[i] = row;
+	uint32_t cells = matrix_size * matrix_stride;
+	snapshot.distance_matrix.resize(cells);
+	if (cells > 0) {
+		memcpy(snapshot.distance_matrix.ptrw(), distance_matrix_internal.ptr(), sizeof(int64_t) * cells);
 	}
-	snapshot.distance_matrix = matrix_copy;
+	snapshot.matrix_size = matrix_size;
+	snapshot.matrix_stride = matrix_stride;
 
 	snapshot.consistent = consistent;
 	snapshot.next_time_point_id = next_time_point_id;
 
+	cached_snapshot = snapshot;
+	cached_snapshot_revision = revision;
 	return snapshot;
 }
 
 void PlannerSTNSolver::restore_snapshot(const Snapshot &p_snapshot) {
-	// Convert Dictionary to internal HashMap
-	time_points_map_internal.clear();
-	Array time_points_keys = p_snapshot.time_points_map.keys();
-	for (int i = 0; i < time_points_keys.size(); i++) {
-		String key = time_points_keys[i];
-		int64_t value = p_snapshot.time_points_map[key];
-		time_points_map_internal[key] = value;
+	// Time points are only ever appended, so a snapshot taken earlier in the search
+	// usually names a prefix of ours and only the newer points need dropping
+	uint32_t count = p_snapshot.time_points_list.size();
+	const String *names = p_snapshot.time_points_list.ptr();
+	bool is_prefix = count <= time_points_list_internal.size();
+	for (uint32_t i = 0; is_prefix && i < count; i++) {
+		is_prefix = names[i] == time_points_list_internal[i];
 	}
-
-	// Convert Array to internal LocalVector
-	time_points_list_internal.clear();
-	time_points_list_internal.resize(p_snapshot.time_points_list.size());
-	for (int i = 0; i < p_snapshot.time_points_list.size(); i++) {
-		time_points_list_internal[i] = p_snapshot.time_points_list[i];
+	if (is_prefix) {
+		for (uint32_t i = count; i < time_points_list_internal.size(); i++) {
+			time_points_map_internal.erase(time_points_list_internal[i]);
+		}
+		time_points_list_internal.resize(count);
+	} else {
+		time_points_map_internal.clear();
+		time_points_list_internal.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			time_points_list_internal[i] = names[i];
+			time_points_map_internal[names[i]] = i;
+		}
 	}
 
-	// Convert Dictionary to internal constraints HashMap
 	constraints_map_internal.clear();
-	Array constraint_keys = p_snapshot.constraints_map.keys();
-	for (int i = 0; i < constraint_keys.size(); i++) {
-		String key = constraint_keys[i];
-		Dictionary constraint_dict = p_snapshot.constraints_map[key];
-		Constraint constraint(constraint_dict["min_distance"], constraint_dict["max_distance"]);
-		constraints_map_internal[key] = constraint;
+	const Pair<uint64_t, Constraint> *edges = p_snapshot.edges.ptr();
+	for (int64_t i = 0; i < p_snapshot.edges.size(); i++) {
+		constraints_map_internal.insert(edges[i].first, edges[i].second);
 	}
 
-	// Convert Array to internal distance matrix
-	distance_matrix_internal.clear();
-	distance_matrix_internal.resize(p_snapshot.distance_matrix.size());
-	for (int i = 0; i < p_snapshot.distance_matrix.size(); i++) {
-		Array row = p_snapshot.distance_matrix[i];
-		LocalVector<int64_t> row_vec;
-		row_vec.resize(row.size());
-		for (int j = 0; j < row.size(); j++) {
-			row_vec[j] = row[j];
-		}
-		distance_matrix_internal[i] = row_vec;
+	matrix_size = p_snapshot.matrix_size;
+	matrix_stride = p_snapshot.matrix_stride;
+	distance_matrix_internal.resize(matrix_stride * matrix_stride);
+	uint32_t cells = matrix_size * matrix_stride;
+	if (cells > 0) {
+		memcpy(distance_matrix_internal.ptr(), p_snapshot.distance_matrix.ptr(), sizeof(int64_t) * cells);
 	}
 
 	consistent = p_snapshot.consistent;
 	next_time_point_id = p_snapshot.next_time_point_id;
+
+	// The solver now matches the snapshot, so the next create_snapshot() can share it
+	discard_levels();
+	revision++;
+	cached_snapshot = p_snapshot;
+	cached_snapshot_revision = revision;
+}
+
+Dictionary PlannerSTNSolver::Snapshot::to_dictionary() const {
+	Dictionary dict;
+
+	Dictionary time_points_dict;
+	Array time_points_array;
+	for (int64_t i = 0; i < time_points_list.size(); i++) {
+		time_points_dict[time_points_list[i]] = i;
+		time_points_array.push_back(time_points_list[i]);
+	}
+	dict["time_points_map"] = time_points_dict;
+	dict["time_points_list"] = time_points_array;
+
+	// Constraints are keyed "from:to" by time point name
+	Dictionary constraints_dict;
+	for (int64_t i = 0; i < edges.size(); i++) {
+		const Pair<uint64_t, Constraint> &edge = edges[i];
+		Dictionary constraint_dict;
+		constraint_dict["min_distance"] = edge.second.min_distance;
+		constraint_dict["max_distance"] = edge.second.max_distance;
+		const String &from = time_points_list[edge.first >> 32];
+		const String &to = time_points_list[edge.first & 0xFFFFFFFF];
+		constraints_dict[from + ":" + to] = constraint_dict;
+	}
+	dict["constraints_map"] = constraints_dict;
+
+	Array matrix;
+	for (uint32_t i = 0; i < matrix_size; i++) {
+		Array row;
+		row.resize(matrix_size);
+		for (uint32_t j = 0; j < matrix_size; j++) {
+			row[j] = distance_matrix[i * matrix_stride + j];
+		}
+		matrix.push_back(row);
+	}
+	dict["distance_matrix"] = matrix;
+
+	dict["consistent"] = consistent;
+	dict["next_time_point_id"] = next_time_point_id;
+	return dict;
 }
 
 void PlannerSTNSolver::clear() {
@@ -455,8 +811,12 @@ void PlannerSTNSolver::clear() {
 	time_points_list_internal.clear();
 	constraints_map_internal.clear();
 	distance_matrix_internal.clear();
+	matrix_size = 0;
+	matrix_stride = 0;
 	consistent = true;
 	next_time_point_id = 0;
+	discard_levels();
+	revision++;
 }
 
 String PlannerSTNSolver::to_string() const {
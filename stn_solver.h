@@ -33,6 +33,7 @@
 #include "core/templates/hash_map.h"
 #include "core/templates/local_vector.h"
 #include "core/templates/pair.h"
+#include "core/templates/vector.h"
 #include "core/typedefs.h"
 #include "core/variant/array.h"
 #include "core/variant/dictionary.h"
@@ -54,38 +55,19 @@ public:
 				min_distance(p_min), max_distance(p_max) {}
 	};
 
-	// Snapshot for backtracking (uses Variant types for serialization)
+	// Snapshot for backtracking. Holds copies of the solver's flat buffers, so creating and
+	// restoring one is a few memcpys; the buffers are copy-on-write and shared between copies.
 	struct Snapshot {
-		Dictionary time_points_map; // Converted to Dictionary for serialization
-		Array time_points_list; // Converted to Array for serialization
-		Dictionary constraints_map; // Converted to Dictionary for serialization
-		Array distance_matrix; // Converted to Array for serialization
-		bool consistent;
-		int64_t next_time_point_id;
-
-		// Convert to Dictionary for Variant storage
-		Dictionary to_dictionary() const {
-			Dictionary dict;
-			dict["time_points_map"] = time_points_map;
-			dict["time_points_list"] = time_points_list;
-			dict["constraints_map"] = constraints_map;
-			dict["distance_matrix"] = distance_matrix;
-			dict["consistent"] = consistent;
-			dict["next_time_point_id"] = next_time_point_id;
-			return dict;
-		}
-
-		// Convert from Dictionary
-		static Snapshot from_dictionary(const Dictionary &p_dict) {
-			Snapshot snapshot;
-			snapshot.time_points_map = p_dict["time_points_map"];
-			snapshot.time_points_list = p_dict["time_points_list"];
-			snapshot.constraints_map = p_dict["constraints_map"];
-			snapshot.distance_matrix = p_dict["distance_matrix"];
-			snapshot.consistent = p_dict["consistent"];
-			snapshot.next_time_point_id = p_dict["next_time_point_id"];
-			return snapshot;
-		}
+		Vector<String> time_points_list; // index -> String name
+		Vector<Pair<uint64_t, Constraint>> edges; // edge_key(from_idx, to_idx) -> Constraint
+		Vector<int64_t> distance_matrix; // matrix_size rows of matrix_stride cells
+		uint32_t matrix_size = 0;
+		uint32_t matrix_stride = 0;
+		bool consistent = true;
+		int64_t next_time_point_id = 0;
+
+		// Convert to Dictionary for debugging
+		Dictionary to_dictionary() const;
 	};
 
 private:
@@ -94,11 +76,37 @@ private:
 	LocalVector<String> time_points_list_internal; // index -> String name
 
 	// Constraints: {from, to} -> Constraint (internal HashMap)
-	HashMap<String, Constraint> constraints_map_internal; // String key "from:to" -> Constraint
+	HashMap<uint64_t, Constraint> constraints_map_internal; // edge_key(from_idx, to_idx) -> Constraint
+
+	// Cells in one allocation that starts on a cache line. With a stride that is a multiple
+	// of MATRIX_ALIGN every row starts on one too, so relax_row() can use aligned vector loads.
+	class CellBuffer {
+		int64_t *cells = nullptr;
+		uint32_t count = 0;
+
+	public:
+		_FORCE_INLINE_ int64_t *ptr() { return cells; }
+		_FORCE_INLINE_ const int64_t *ptr() const { return cells; }
+		_FORCE_INLINE_ uint32_t size() const { return count; }
+		_FORCE_INLINE_ bool is_empty() const { return count == 0; }
+		_FORCE_INLINE_ int64_t &operator[](uint32_t p_index) { return cells[p_index]; }
+		void resize(uint32_t p_count); // Keeps the first cells, like LocalVector
+		void clear();
+
+		CellBuffer() {}
+		CellBuffer(const CellBuffer &p_other);
+		CellBuffer(CellBuffer &&p_other);
+		CellBuffer &operator=(const CellBuffer &p_other);
+		CellBuffer &operator=(CellBuffer &&p_other);
+		~CellBuffer() { clear(); }
+	};
 
-	// Floyd-Warshall distance matrix: distance_matrix[i][j] = shortest distance from i to j
+	// Floyd-Warshall distance matrix: distance(i, j) = shortest distance from i to j
 	// Uses infinity for unreachable, negative values indicate negative cycles
-	LocalVector<LocalVector<int64_t>> distance_matrix_internal; // 2D LocalVector for efficiency
+	// Stored row-major in one buffer; rows are padded to matrix_stride with STN_INFINITY
+	CellBuffer distance_matrix_internal;
+	uint32_t matrix_size = 0; // Time points covered by the matrix
+	uint32_t matrix_stride = 0; // Cells per row, a multiple of MATRIX_ALIGN
 
 	// Consistency flag
 	bool consistent;
@@ -106,17 +114,68 @@ private:
 	// Next time point ID (for unique indexing)
 	int64_t next_time_point_id;
 
+	// Bumped on every change; create_snapshot() hands out the cached snapshot while it matches
+	uint64_t revision = 0;
+	mutable Snapshot cached_snapshot;
+	mutable uint64_t cached_snapshot_revision = UINT64_MAX;
+
+	// Undo trail for push_level()/pop_level(). While a level is open, every change records
+	// what it overwrote; time points are only appended, so a level just remembers the count.
+	struct Level {
+		uint32_t cell_trail_size = 0;
+		uint32_t edge_trail_size = 0;
+		uint32_t image_count = 0;
+		uint32_t time_point_count = 0;
+		uint32_t matrix_size = 0;
+		bool consistent = true;
+		int64_t next_time_point_id = 0;
+	};
+	struct EdgeChange {
+		uint64_t key = 0; // edge_key(from_idx, to_idx)
+		Constraint old_constraint;
+		bool existed = false;
+	};
+	// The whole matrix, kept when it is reallocated so earlier cell changes still line up
+	struct MatrixImage {
+		CellBuffer cells;
+		uint32_t stride = 0;
+		uint32_t cell_trail_size = 0;
+	};
+	LocalVector<Level> levels;
+	LocalVector<Pair<uint32_t, int64_t>> cell_trail; // Cell index -> previous distance
+	LocalVector<EdgeChange> edge_trail;
+	LocalVector<MatrixImage> image_trail;
+	LocalVector<int64_t> trail_scratch; // Matrix or row copy diffed after a change
+	uint32_t scratch_size = 0;
+	uint32_t scratch_stride = 0;
+
 	// Constants (avoid INFINITY macro conflict by using different name)
 	static constexpr int64_t STN_INFINITY = INT64_MAX;
 	static constexpr int64_t STN_NEG_INFINITY = INT64_MIN + 1; // Avoid overflow
+	static constexpr uint32_t MATRIX_ALIGN = 8; // Cells per 64-byte cache line
+
+	_FORCE_INLINE_ int64_t &distance(uint32_t p_from, uint32_t p_to) { return distance_matrix_internal.ptr()[p_from * matrix_stride + p_to]; }
+	_FORCE_INLINE_ int64_t distance(uint32_t p_from, uint32_t p_to) const { return distance_matrix_internal.ptr()[p_from * matrix_stride + p_to]; }
 
 	// Helper methods
 	int64_t get_time_point_index(const String &p_name) const;
+	static uint64_t edge_key(uint32_t p_from, uint32_t p_to) { return ((uint64_t)p_from << 32) | p_to; }
 	void ensure_time_point(const String &p_name);
+	void resize_distance_matrix(uint32_t p_size);
 	void rebuild_distance_matrix();
 	void run_floyd_warshall();
+	void propagate_edge(uint32_t p_from, uint32_t p_to, int64_t p_weight);
+	static int64_t add_distances(int64_t p_a, int64_t p_b);
 	bool check_negative_cycles() const;
 
+	// Undo trail recording, a no-op while no level is open
+	_FORCE_INLINE_ bool is_recording() const { return !levels.is_empty(); }
+	void record_edge(uint64_t p_key);
+	void record_cells(uint32_t p_first, const int64_t *p_before, uint32_t p_count);
+	void begin_matrix_change();
+	void end_matrix_change();
+	void discard_levels();
+
 	// Constraint intersection (tighten constraints)
 	Constraint intersect_constraints(const Constraint &p_a, const Constraint &p_b) const;
 
@@ -128,6 +187,7 @@ public:
 	int64_t add_time_point(const String &p_name);
 	bool has_time_point(const String &p_name) const;
 	Array get_time_points() const;
+	int64_t get_time_point_count() const { return time_points_list_internal.size(); }
 
 	// Constraint management
 	bool add_constraint(const String &p_from, const String &p_to, int64_t p_min, int64_t p_max);
@@ -140,6 +200,13 @@ public:
 	bool is_consistent() const { return consistent; }
 	void check_consistency(); // Re-run Floyd-Warshall and update consistency
 
+	// Undo levels for chronological backtracking. pop_level() puts the STN back the way it was
+	// at the matching push_level(), at a cost proportional to what changed in between.
+	// restore_snapshot() and clear() discard all levels.
+	void push_level();
+	void pop_level();
+	int get_level_count() const { return levels.size(); }
+
 	// Distance queries
 	int64_t get_distance(const String &p_from, const String &p_to) const;
 	int64_t get_earliest_time(const String &p_point) const;
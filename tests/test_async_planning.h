@@ -0,0 +1,178 @@
+/**************************************************************************/
+/*  test_async_planning.h                                                 */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for background planning on the WorkerThreadPool
+
+#pragma once
+
+#include "../domain.h"
+#include "../plan.h"
+#include "core/object/message_queue.h"
+#include "tests/test_macros.h"
+
+namespace TestAsyncPlanning {
+
+static Variant async_move_action(Dictionary p_state, String p_target) {
+	Dictionary new_state = p_state.duplicate();
+	new_state["position"] = p_target;
+	return new_state;
+}
+
+static Variant async_travel_method(Dictionary p_state, String p_target) {
+	Array subtasks;
+	Array action;
+	action.push_back("async_move_action");
+	action.push_back(p_target);
+	subtasks.push_back(action);
+	return subtasks;
+}
+
+static int completed_signal_count = 0;
+static int64_t completed_task_id = -1;
+static Variant completed_plan;
+
+static void on_plan_completed(int64_t p_task_id, Variant p_plan, int p_status) {
+	completed_signal_count++;
+	completed_task_id = p_task_id;
+	completed_plan = p_plan;
+}
+
+static Ref<PlannerPlan> create_async_plan() {
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&async_move_action));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> task_methods;
+	task_methods.push_back(callable_mp_static(&async_travel_method));
+	domain->add_task_methods("travel", task_methods);
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	plan->connect("plan_completed", callable_mp_static(&on_plan_completed));
+	return plan;
+}
+
+static Array create_travel_todo_list(const String &p_target) {
+	Array todo_list;
+	Array task;
+	task.push_back("travel");
+	task.push_back(p_target);
+	todo_list.push_back(task);
+	return todo_list;
+}
+
+TEST_CASE("[Modules][AsyncPlanning] Waiting returns the same plan as find_plan") {
+	completed_signal_count = 0;
+	Ref<PlannerPlan> plan = create_async_plan();
+	Dictionary state;
+	state["position"] = "home";
+	Array todo_list = create_travel_todo_list("park");
+
+	Variant expected = plan->find_plan(state, todo_list);
+	REQUIRE(expected.get_type() == Variant::ARRAY);
+
+	int64_t task_id = plan->find_plan_async(state, todo_list);
+	CHECK(task_id > 0);
+	Variant result = plan->wait_for_async_plan(task_id);
+	CHECK(result == expected);
+	CHECK(plan->is_async_plan_completed(task_id));
+
+	// The signal is emitted once, even though the deferred completion still runs
+	MessageQueue::get_singleton()->flush();
+	CHECK(completed_signal_count == 1);
+	CHECK(completed_task_id == task_id);
+	CHECK(completed_plan == expected);
+}
+
+TEST_CASE("[Modules][AsyncPlanning] Completion is delivered through the message queue") {
+	completed_signal_count = 0;
+	Ref<PlannerPlan> plan = create_async_plan();
+	Dictionary state;
+	state["position"] = "home";
+
+	int64_t first = plan->find_plan_async(state, create_travel_todo_list("park"));
+	int64_t second = plan->find_plan_async(state, create_travel_todo_list("shop"));
+	CHECK(first != second);
+
+	while (!plan->is_async_plan_completed(first) || !plan->is_async_plan_completed(second)) {
+		OS::get_singleton()->delay_usec(100);
+	}
+	MessageQueue::get_singleton()->flush();
+	CHECK(completed_signal_count == 2);
+
+	// The caller's plan keeps its own solution graph
+	CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_NONE);
+}
+
+TEST_CASE("[Modules][AsyncPlanning] Domain snapshots are independent") {
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&async_move_action));
+	domain->add_actions(actions);
+
+	Ref<PlannerDomain> snapshot = domain->create_snapshot();
+	CHECK(snapshot->action_dictionary.size() == 1);
+
+	TypedArray<Callable> more_actions;
+	more_actions.push_back(callable_mp_static(&async_travel_method));
+	domain->add_actions(more_actions);
+	CHECK(domain->action_dictionary.size() == 2);
+	CHECK(snapshot->action_dictionary.size() == 1);
+}
+
+TEST_CASE("[Modules][AsyncPlanning] Batch planning matches per-agent find_plan") {
+	Ref<PlannerPlan> plan = create_async_plan();
+	const char *targets[] = { "park", "shop", "school", "harbor" };
+
+	Array states;
+	Array todo_lists;
+	for (int i = 0; i < 32; i++) {
+		Dictionary state;
+		state["position"] = "home";
+		states.push_back(state);
+		todo_lists.push_back(create_travel_todo_list(targets[i % 4]));
+	}
+
+	Array results = plan->find_plans(states, todo_lists);
+	REQUIRE(results.size() == states.size());
+	for (int i = 0; i < results.size(); i++) {
+		CHECK(results[i] == plan->find_plan(states[i], todo_lists[i]));
+	}
+
+	// Agents' states are never modified
+	Dictionary first_state = states[0];
+	CHECK(first_state["position"] == "home");
+
+	CHECK(plan->find_plans(Array(), Array()).is_empty());
+}
+
+} // namespace TestAsyncPlanning
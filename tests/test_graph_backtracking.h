@@ -32,7 +32,9 @@
 
 #pragma once
 
+#include "../backtracking.h"
 #include "../domain.h"
+#include "../graph_operations.h"
 #include "../plan.h"
 #include "../planner_state.h"
 #include "../planner_time_range.h"
@@ -100,6 +102,26 @@ TEST_CASE("[Modules][GraphBacktracking] Basic graph-based planning") {
 		CHECK(final_state == initial_state);
 	}
 
+	SUBCASE("Long todo list runs without deep recursion") {
+		// Each action is its own planning step; the loop must not grow the native stack per step
+		const int action_count = 5000;
+		Dictionary initial_state;
+		initial_state["initialized"] = true;
+
+		Array todo_list;
+		for (int i = 0; i < action_count; i++) {
+			Array action;
+			action.push_back("test_action_success");
+			action.push_back("arg" + itos(i));
+			todo_list.push_back(action);
+		}
+
+		Variant plan_result = plan->find_plan(initial_state, todo_list);
+		CHECK(plan_result.get_type() == Variant::ARRAY);
+		Array actions = plan_result;
+		CHECK(actions.size() == action_count);
+	}
+
 	// Ref<> objects handle cleanup automatically via reference counting
 }
 
@@ -310,15 +332,282 @@ TEST_CASE("[Modules][GraphBacktracking] Solution graph structure") {
 		todo_list.push_back(task);
 
 		Dictionary final_state = plan->run_lazy_refineahead(initial_state, todo_list);
-
-		// The solution graph should be populated internally
-		// We can't directly access it, but if planning succeeds, graph was created
 		CHECK(final_state.has("executed"));
+
+		// Root -> task -> action
+		Dictionary graph = plan->get_solution_graph();
+		CHECK(graph.size() == 3);
+
+		Dictionary root_node = graph[0];
+		CHECK(int(root_node["type"]) == static_cast<int>(PlannerNodeType::TYPE_ROOT));
+		CHECK(int(root_node["parent"]) == -1);
+		TypedArray<int> root_successors = root_node["successors"];
+		CHECK(root_successors.size() == 1);
+
+		Dictionary task_node = graph[root_successors[0]];
+		CHECK(int(task_node["type"]) == static_cast<int>(PlannerNodeType::TYPE_TASK));
+		CHECK(int(task_node["status"]) == static_cast<int>(PlannerNodeStatus::STATUS_CLOSED));
+		CHECK(task_node["selected_method"] == Variant(callable_mp_static(&test_task_method)));
+		CHECK(int(task_node["parent"]) == 0);
+		TypedArray<int> task_successors = task_node["successors"];
+		CHECK(task_successors.size() == 1);
+
+		Dictionary action_node = graph[task_successors[0]];
+		CHECK(int(action_node["type"]) == static_cast<int>(PlannerNodeType::TYPE_ACTION));
+		CHECK(int(action_node["status"]) == static_cast<int>(PlannerNodeStatus::STATUS_CLOSED));
+		Array action_info = action_node["info"];
+		CHECK(action_info.size() == 2);
+		CHECK(action_info[0] == "test_action_success");
+		CHECK(action_info[1] == "arg1");
+		CHECK(int(action_node["parent"]) == int(root_successors[0]));
 	}
 
 	// Ref<> objects handle cleanup automatically via reference counting
 }
 
+TEST_CASE("[Modules][GraphBacktracking] Planning limits and status") {
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	Ref<PlannerDomain> domain = create_test_domain();
+	plan->set_current_domain(domain);
+	CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_NONE);
+
+	Dictionary initial_state;
+	initial_state["initialized"] = true;
+	Array task;
+	task.push_back("test_task");
+	task.push_back("arg1");
+	Array todo_list;
+	todo_list.push_back(task);
+
+	SUBCASE("Success is reported") {
+		Variant result = plan->find_plan(initial_state, todo_list);
+		CHECK(result.get_type() == Variant::ARRAY);
+		CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+		CHECK(plan->get_last_expansion_count() == 2);
+	}
+
+	SUBCASE("Depth limit fails refinements below it") {
+		// The task sits at depth 1 and its action at depth 2
+		plan->set_max_depth(1);
+		Variant result = plan->find_plan(initial_state, todo_list);
+		CHECK(result == Variant(false));
+		CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_FAILED);
+	}
+
+	SUBCASE("Expansion budget is distinguished from failure") {
+		Array actions;
+		for (int i = 0; i < 100; i++) {
+			Array action;
+			action.push_back("test_action_success");
+			action.push_back("arg" + itos(i));
+			actions.push_back(action);
+		}
+		plan->set_max_expansions(10);
+		Variant result = plan->find_plan(initial_state, actions);
+		CHECK(result == Variant(false));
+		CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_EXPANSION_BUDGET_EXHAUSTED);
+		CHECK(plan->get_last_expansion_count() == 10);
+	}
+
+	SUBCASE("Time budget is distinguished from failure") {
+		Array actions;
+		for (int i = 0; i < 5000; i++) {
+			Array action;
+			action.push_back("test_action_success");
+			action.push_back("arg" + itos(i));
+			actions.push_back(action);
+		}
+		plan->set_time_budget_usec(1);
+		Variant result = plan->find_plan(initial_state, actions);
+		CHECK(result == Variant(false));
+		CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_TIME_BUDGET_EXHAUSTED);
+	}
+}
+
+TEST_CASE("[Modules][GraphBacktracking] Parent links") {
+	PlannerSolutionGraph graph;
+	Dictionary action_dict;
+	action_dict["test_action_success"] = callable_mp_static(&test_action_success);
+	Array action;
+	action.push_back("test_action_success");
+	action.push_back("arg1");
+	Array todo_list;
+	todo_list.push_back(action);
+	todo_list.push_back(action);
+	PlannerGraphOperations::add_nodes_and_edges(graph, 0, todo_list, action_dict, Dictionary(), Dictionary(), TypedArray<Callable>());
+
+	int first = graph.get_first_successor(0);
+	int second = graph.get_next_sibling(first);
+	CHECK(graph.get_parent(0) == -1);
+	CHECK(PlannerGraphOperations::find_predecessor(graph, first) == 0);
+	CHECK(PlannerGraphOperations::find_predecessor(graph, second) == 0);
+
+	PlannerGraphOperations::remove_descendants(graph, 0);
+	CHECK_FALSE(graph.has_node(first));
+	CHECK(PlannerGraphOperations::find_predecessor(graph, first) == -1);
+	CHECK(graph.get_first_successor(0) == PlannerSolutionGraph::NO_NODE);
+}
+
+TEST_CASE("[Modules][GraphBacktracking] In-place backtracking resumes after the selected method") {
+	PlannerSolutionGraph graph;
+	TypedArray<Callable> methods;
+	methods.push_back(callable_mp_static(&test_task_method));
+	methods.push_back(callable_mp_static(&test_task_method));
+
+	Array task;
+	task.push_back("test_task");
+	int task_id = graph.create_node(PlannerNodeType::TYPE_TASK, task, methods);
+	graph.add_successor(0, task_id);
+	graph.set_node_status(task_id, PlannerNodeStatus::STATUS_CLOSED);
+	graph.set_selected_method_index(task_id, 0);
+
+	Array action;
+	action.push_back("test_action_success");
+	int action_id = graph.create_node(PlannerNodeType::TYPE_ACTION, action);
+	graph.add_successor(task_id, action_id);
+
+	// The task still has an untried method, so it is reopened and its old refinement dropped
+	PlannerBacktracking::BacktrackResult result = PlannerBacktracking::backtrack(graph, task_id, action_id);
+	CHECK(result.current_node_id == task_id);
+	CHECK(result.parent_node_id == 0);
+	CHECK(graph.get_node_status(task_id) == PlannerNodeStatus::STATUS_OPEN);
+	CHECK_FALSE(graph.has_node(action_id));
+	CHECK(graph.get_first_successor(task_id) == PlannerSolutionGraph::NO_NODE);
+
+	// Once the last method has been used the failure propagates to the root
+	graph.set_node_status(task_id, PlannerNodeStatus::STATUS_CLOSED);
+	graph.set_selected_method_index(task_id, 1);
+	action_id = graph.create_node(PlannerNodeType::TYPE_ACTION, action);
+	graph.add_successor(task_id, action_id);
+	result = PlannerBacktracking::backtrack(graph, task_id, action_id);
+	CHECK(result.current_node_id == -1);
+	CHECK(result.parent_node_id == -1);
+	CHECK(graph.get_node_status(task_id) == PlannerNodeStatus::STATUS_FAILED);
+}
+
+static Variant test_choice_method_fail(Dictionary p_state, String p_arg) {
+	return varray(varray("test_action_fail", p_arg));
+}
+
+static Variant test_choice_method_deep_fail(Dictionary p_state, String p_arg) {
+	return varray(varray("test_deep_task", p_arg));
+}
+
+static Variant test_deep_task_method(Dictionary p_state, String p_arg) {
+	return varray(varray("test_action_fail", p_arg));
+}
+
+static Variant test_choice_method_third(Dictionary p_state, String p_arg) {
+	return varray(varray("test_action_success2", "third"));
+}
+
+static Variant test_choice_method_fourth(Dictionary p_state, String p_arg) {
+	return varray(varray("test_action_success2", "fourth"));
+}
+
+static std::atomic<int> test_spin_calls;
+
+static Variant test_spin_method(Dictionary p_state, String p_arg) {
+	test_spin_calls.fetch_add(1);
+	return varray(varray("fall", p_arg));
+}
+
+static Ref<PlannerPlan> create_choice_plan() {
+	Ref<PlannerDomain> domain = create_test_domain();
+
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_action_fail));
+	actions.push_back(callable_mp_static(&test_action_success2));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> choice_methods;
+	choice_methods.push_back(callable_mp_static(&test_choice_method_fail));
+	choice_methods.push_back(callable_mp_static(&test_choice_method_deep_fail));
+	choice_methods.push_back(callable_mp_static(&test_choice_method_third));
+	choice_methods.push_back(callable_mp_static(&test_choice_method_fourth));
+	domain->add_task_methods("choose", choice_methods);
+
+	TypedArray<Callable> failing_methods;
+	failing_methods.push_back(callable_mp_static(&test_choice_method_fail));
+	failing_methods.push_back(callable_mp_static(&test_choice_method_deep_fail));
+	domain->add_task_methods("choose_badly", failing_methods);
+
+	TypedArray<Callable> deep_methods;
+	deep_methods.push_back(callable_mp_static(&test_deep_task_method));
+	domain->add_task_methods("test_deep_task", deep_methods);
+
+	TypedArray<Callable> spin_methods;
+	spin_methods.push_back(callable_mp_static(&test_spin_method));
+	spin_methods.push_back(callable_mp_static(&test_spin_method));
+	spin_methods.push_back(callable_mp_static(&test_spin_method));
+	domain->add_task_methods("spin", spin_methods);
+
+	TypedArray<Callable> fall_methods;
+	fall_methods.push_back(callable_mp_static(&test_spin_method));
+	domain->add_task_methods("fall", fall_methods);
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	return plan;
+}
+
+TEST_CASE("[Modules][GraphBacktracking] Parallel method exploration keeps method order") {
+	Ref<PlannerPlan> plan = create_choice_plan();
+	Dictionary initial_state;
+	initial_state["initialized"] = true;
+
+	SUBCASE("First successful method in order wins") {
+		Array todo_list = varray(varray("choose", "x"), varray("test_task", "y"));
+
+		Variant sequential = plan->find_plan(initial_state, todo_list);
+		REQUIRE(sequential.get_type() == Variant::ARRAY);
+		CHECK(Array(sequential)[0] == Variant(varray("test_action_success2", "third")));
+		const TypedArray<Variant> sequential_blacklist = plan->get_blacklisted_commands();
+		CHECK(sequential_blacklist.size() == 1);
+
+		plan->set_parallel_method_depth(2);
+		Variant parallel = plan->find_plan(initial_state, todo_list);
+		CHECK(parallel == sequential);
+		CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+
+		// The command the methods before the adopted one blacklisted is kept, once
+		CHECK(plan->get_blacklisted_commands() == sequential_blacklist);
+
+		// The adopted graph records the real method index at the choice point
+		Dictionary graph = plan->get_solution_graph();
+		Dictionary root = graph[0];
+		TypedArray<int> root_successors = root["successors"];
+		Dictionary choice = graph[root_successors[0]];
+		CHECK(choice["selected_method"] == Variant(callable_mp_static(&test_choice_method_third)));
+	}
+
+	SUBCASE("Exhausted choice points fail like the sequential search") {
+		Array todo_list = varray(varray("choose_badly", "x"));
+		CHECK(plan->find_plan(initial_state, todo_list) == Variant(false));
+
+		const TypedArray<Variant> sequential_blacklist = plan->get_blacklisted_commands();
+
+		plan->set_parallel_method_depth(2);
+		CHECK(plan->find_plan(initial_state, todo_list) == Variant(false));
+		CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_FAILED);
+		CHECK(plan->get_blacklisted_commands() == sequential_blacklist);
+	}
+
+	SUBCASE("Workers share the expansion budget") {
+		Array todo_list = varray(varray("spin", "x"));
+		// Each method falls to the depth limit and fails, so the three together need about 90 expansions
+		plan->set_max_depth(30);
+		plan->set_max_expansions(50);
+		plan->set_parallel_method_depth(2);
+		test_spin_calls.store(0);
+		CHECK(plan->find_plan(initial_state, todo_list) == Variant(false));
+		CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_EXPANSION_BUDGET_EXHAUSTED);
+		// Each worker may pass the check once before the others' expansions are counted
+		CHECK(test_spin_calls.load() <= 50 + 3);
+		CHECK(plan->get_last_expansion_count() <= 50 + 3);
+	}
+}
+
 // Static helpers for state snapshot tests
 static Variant test_action_modify(Dictionary p_state, String p_key, int p_value) {
 	Dictionary new_state = p_state.duplicate();
@@ -377,7 +666,220 @@ TEST_CASE("[Modules][GraphBacktracking] State snapshot restoration") {
 		CHECK(final_state.has("initialized"));
 	}
 
+	SUBCASE("Snapshots share the state until a method may write to it") {
+		Dictionary initial_state;
+		initial_state["initialized"] = true;
+		Array todo_list = varray(varray("test_task", "test"));
+
+		// The task node and its first action see the same state, but the method between
+		// them may write to it, so the action node holds a copy
+		Dictionary final_state = plan->run_lazy_refineahead(initial_state, todo_list);
+		CHECK_FALSE(initial_state.has("step1"));
+		CHECK(final_state["step2"] == Variant(2));
+
+		Dictionary graph = plan->get_solution_graph();
+		Dictionary root = graph[0];
+		TypedArray<int> root_successors = root["successors"];
+		Dictionary task_node = graph[root_successors[0]];
+		TypedArray<int> task_successors = task_node["successors"];
+		Dictionary first_action_node = graph[task_successors[0]];
+		Dictionary task_state = task_node["state"];
+		Dictionary first_action_state = first_action_node["state"];
+		CHECK(task_state["initialized"] == Variant(true));
+		CHECK(first_action_state == task_state);
+		CHECK(first_action_state.id() != task_state.id());
+
+		// A pure method does not write, so both nodes hold the same Dictionary
+		domain->set_method_pure(callable_mp_static(&test_task_method_multiple), true);
+		plan->run_lazy_refineahead(initial_state, todo_list);
+		Dictionary pure_graph = plan->get_solution_graph();
+		Dictionary pure_root = pure_graph[0];
+		TypedArray<int> pure_root_successors = pure_root["successors"];
+		Dictionary pure_task_node = pure_graph[pure_root_successors[0]];
+		TypedArray<int> pure_task_successors = pure_task_node["successors"];
+		Dictionary pure_action_node = pure_graph[pure_task_successors[0]];
+		CHECK(Dictionary(pure_action_node["state"]).id() == Dictionary(pure_task_node["state"]).id());
+	}
+
 	// Ref<> objects handle cleanup automatically via reference counting
 }
 
+static Variant test_action_move(Dictionary p_state, String p_object, String p_place) {
+	Dictionary new_state = p_state.duplicate();
+	Dictionary new_loc = Dictionary(p_state["loc"]).duplicate();
+	new_loc[p_object] = p_place;
+	new_state["loc"] = new_loc;
+	return new_state;
+}
+
+static Variant test_trail_method_fails(Dictionary p_state, String p_task_name) {
+	return varray(
+			varray("test_action_modify", "step1", 1),
+			varray("test_action_move", "a", "table"),
+			varray("test_action_move", "c", "shelf"),
+			varray("test_action_fail", "x"));
+}
+
+static Variant test_trail_method_succeeds(Dictionary p_state, String p_task_name) {
+	return varray(
+			varray("test_action_modify", "step2", 2),
+			varray("test_action_move", "b", "table"));
+}
+
+TEST_CASE("[Modules][GraphBacktracking] State trail undoes actions on backtracking") {
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_action_modify));
+	actions.push_back(callable_mp_static(&test_action_move));
+	actions.push_back(callable_mp_static(&test_action_fail));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> task_methods;
+	task_methods.push_back(callable_mp_static(&test_trail_method_fails));
+	task_methods.push_back(callable_mp_static(&test_trail_method_succeeds));
+	domain->add_task_methods("test_task", task_methods);
+	plan->set_current_domain(domain);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	loc["b"] = "floor";
+	Dictionary initial_state;
+	initial_state["loc"] = loc;
+
+	Array todo_list = varray(varray("test_task", "test"));
+	Dictionary snapshot_state = plan->run_lazy_refineahead(initial_state, todo_list);
+
+	plan->set_use_state_trail(true);
+	Dictionary trail_state = plan->run_lazy_refineahead(initial_state, todo_list);
+
+	CHECK(trail_state == snapshot_state);
+	CHECK_FALSE(trail_state.has("step1"));
+	CHECK(trail_state["step2"] == Variant(2));
+	Dictionary trail_loc = trail_state["loc"];
+	CHECK(trail_loc["a"] == Variant("floor"));
+	CHECK(trail_loc["b"] == Variant("table"));
+	CHECK_FALSE(trail_loc.has("c"));
+
+	// The caller's nested dictionaries are never written
+	CHECK(loc.size() == 2);
+	CHECK(loc["b"] == Variant("floor"));
+}
+
+TEST_CASE("[Modules][GraphBacktracking] Persistent state versions restore nodes like snapshots") {
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_action_modify));
+	actions.push_back(callable_mp_static(&test_action_move));
+	actions.push_back(callable_mp_static(&test_action_fail));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> task_methods;
+	task_methods.push_back(callable_mp_static(&test_trail_method_fails));
+	task_methods.push_back(callable_mp_static(&test_trail_method_succeeds));
+	domain->add_task_methods("test_task", task_methods);
+	plan->set_current_domain(domain);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	loc["b"] = "floor";
+	Dictionary initial_state;
+	initial_state["loc"] = loc;
+
+	// The task node is revisited after backtracking, from a version that holds step0
+	Array todo_list = varray(varray("test_action_modify", "step0", 1), varray("test_task", "test"));
+	Variant expected_plan = plan->find_plan(initial_state, todo_list);
+	REQUIRE(expected_plan.get_type() == Variant::ARRAY);
+	Dictionary expected_state = plan->run_lazy_refineahead(initial_state, todo_list);
+
+	plan->set_use_persistent_state(true);
+	CHECK(plan->find_plan(initial_state, todo_list) == expected_plan);
+	Dictionary persistent_state = plan->run_lazy_refineahead(initial_state, todo_list);
+	CHECK(persistent_state == expected_state);
+	CHECK(persistent_state["step0"] == Variant(1));
+	CHECK_FALSE(persistent_state.has("step1"));
+	Dictionary persistent_loc = persistent_state["loc"];
+	CHECK(persistent_loc["a"] == Variant("floor"));
+	CHECK_FALSE(persistent_loc.has("c"));
+
+	// Node states in the solution graph come from their versions
+	Dictionary graph = plan->get_solution_graph();
+	Dictionary root = graph[0];
+	TypedArray<int> root_successors = root["successors"];
+	Dictionary first_action = graph[root_successors[0]];
+	CHECK(first_action["state"] == Variant(initial_state));
+
+	// The caller's nested dictionaries are never written
+	CHECK(loc.size() == 2);
+	CHECK(loc["b"] == Variant("floor"));
+}
+
+static Variant test_method_writes_state(Dictionary p_state, String p_task_name) {
+	// Scratch writes to the state argument must succeed, as they did before snapshots were shared
+	p_state["scratch"] = p_task_name;
+	if (!p_state.has("scratch")) {
+		return false;
+	}
+	return varray(varray("test_action_modify", "step2", 2));
+}
+
+TEST_CASE("[Modules][GraphBacktracking] Methods can write to their state argument") {
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_action_modify));
+	actions.push_back(callable_mp_static(&test_action_move));
+	actions.push_back(callable_mp_static(&test_action_fail));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> task_methods;
+	task_methods.push_back(callable_mp_static(&test_trail_method_fails));
+	task_methods.push_back(callable_mp_static(&test_method_writes_state));
+	domain->add_task_methods("test_task", task_methods);
+	plan->set_current_domain(domain);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	Dictionary initial_state;
+	initial_state["loc"] = loc;
+
+	// The writing method only runs after backtracking out of the first one
+	Variant result = plan->find_plan(initial_state, varray(varray("test_task", "test")));
+	CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+	CHECK(result == Variant(varray(varray("test_action_modify", "step2", 2))));
+	CHECK_FALSE(initial_state.has("scratch"));
+
+	// On a first visit too
+	domain = memnew(PlannerDomain);
+	domain->add_actions(actions);
+	TypedArray<Callable> writing_methods;
+	writing_methods.push_back(callable_mp_static(&test_method_writes_state));
+	domain->add_task_methods("test_task", writing_methods);
+	plan->set_current_domain(domain);
+	result = plan->find_plan(initial_state, varray(varray("test_task", "test")));
+	CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+}
+
+TEST_CASE("[Modules][GraphBacktracking] Failed commands are blacklisted once") {
+	Ref<PlannerPlan> plan = create_choice_plan();
+	Dictionary initial_state;
+	initial_state["initialized"] = true;
+
+	// Both methods of choose_badly end in test_action_fail with the same arguments
+	CHECK(plan->find_plan(initial_state, varray(varray("choose_badly", "x"))) == Variant(false));
+	CHECK(plan->get_blacklisted_command_count() == 1);
+	TypedArray<Variant> blacklisted = plan->get_blacklisted_commands();
+	REQUIRE(blacklisted.size() == 1);
+	CHECK(blacklisted[0] == Variant(varray("test_action_fail", "x")));
+
+	// Each call starts with an empty blacklist
+	plan->find_plan(initial_state, varray(varray("choose", "y")));
+	CHECK(plan->get_blacklisted_command_count() == 1);
+	CHECK(plan->get_blacklisted_commands()[0] == Variant(varray("test_action_fail", "y")));
+}
+
 } // namespace TestGraphBacktracking
@@ -59,35 +59,35 @@ namespace TestLogistics {
 // Actions
 
 static Variant drive_truck(Dictionary p_state, String p_truck, String p_location) {
-	Dictionary truck_at = p_state["truck_at"];
+	Dictionary truck_at = Dictionary(p_state["truck_at"]).duplicate();
 	truck_at[p_truck] = p_location;
 	p_state["truck_at"] = truck_at;
 	return p_state;
 }
 
 static Variant fly_plane(Dictionary p_state, String p_plane, String p_airport) {
-	Dictionary plane_at = p_state["plane_at"];
+	Dictionary plane_at = Dictionary(p_state["plane_at"]).duplicate();
 	plane_at[p_plane] = p_airport;
 	p_state["plane_at"] = plane_at;
 	return p_state;
 }
 
 static Variant load_truck(Dictionary p_state, String p_object, String p_truck) {
-	Dictionary at = p_state["at"];
+	Dictionary at = Dictionary(p_state["at"]).duplicate();
 	at[p_object] = p_truck;
 	p_state["at"] = at;
 	return p_state;
 }
 
 static Variant load_plane(Dictionary p_state, String p_object, String p_plane) {
-	Dictionary at = p_state["at"];
+	Dictionary at = Dictionary(p_state["at"]).duplicate();
 	at[p_object] = p_plane;
 	p_state["at"] = at;
 	return p_state;
 }
 
 static Variant unload_plane(Dictionary p_state, String p_object, String p_airport) {
-	Dictionary at = p_state["at"];
+	Dictionary at = Dictionary(p_state["at"]).duplicate();
 	Variant plane = at[p_object];
 	Dictionary plane_at = p_state["plane_at"];
 	if (plane_at[plane] == p_airport) {
@@ -98,7 +98,7 @@ static Variant unload_plane(Dictionary p_state, String p_object, String p_airpor
 }
 
 static Variant unload_truck(Dictionary p_state, String p_object, String p_location) {
-	Dictionary at = p_state["at"];
+	Dictionary at = Dictionary(p_state["at"]).duplicate();
 	Variant truck = at[p_object];
 	Dictionary truck_at = p_state["truck_at"];
 	if (truck_at[truck] == p_location) {
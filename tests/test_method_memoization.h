@@ -0,0 +1,128 @@
+/**************************************************************************/
+/*  test_method_memoization.h                                             */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for memoized pure methods in PlannerPlan
+
+#pragma once
+
+#include "../domain.h"
+#include "../plan.h"
+#include "tests/test_macros.h"
+
+namespace TestMethodMemoization {
+
+static Variant test_memo_move(Dictionary p_state, String p_object, String p_place) {
+	Dictionary new_state = p_state.duplicate();
+	Dictionary new_loc = Dictionary(p_state["loc"]).duplicate();
+	new_loc[p_object] = p_place;
+	new_state["loc"] = new_loc;
+	return new_state;
+}
+
+static Variant test_memo_fail(Dictionary p_state, String p_arg) {
+	return Variant();
+}
+
+// Both orderings reach dead_end from the same state
+static Variant test_memo_a_then_b(Dictionary p_state, String p_arg) {
+	return varray(
+			varray("test_memo_move", "a", "table"),
+			varray("test_memo_move", "b", "table"),
+			varray("dead_end", p_arg));
+}
+
+static Variant test_memo_b_then_a(Dictionary p_state, String p_arg) {
+	return varray(
+			varray("test_memo_move", "b", "table"),
+			varray("test_memo_move", "a", "table"),
+			varray("dead_end", p_arg));
+}
+
+static Variant test_memo_on_shelf(Dictionary p_state, String p_arg) {
+	return varray(varray("test_memo_move", "a", "shelf"));
+}
+
+static int test_counted_method_calls = 0;
+
+static Variant test_counted_dead_end(Dictionary p_state, String p_arg) {
+	test_counted_method_calls++;
+	return varray(varray("test_memo_fail", p_arg));
+}
+
+TEST_CASE("[Modules][MethodMemoization] Pure task methods run once per state") {
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_memo_move));
+	actions.push_back(callable_mp_static(&test_memo_fail));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> arrange_methods;
+	arrange_methods.push_back(callable_mp_static(&test_memo_a_then_b));
+	arrange_methods.push_back(callable_mp_static(&test_memo_b_then_a));
+	arrange_methods.push_back(callable_mp_static(&test_memo_on_shelf));
+	domain->add_task_methods("arrange", arrange_methods);
+
+	TypedArray<Callable> dead_end_methods;
+	dead_end_methods.push_back(callable_mp_static(&test_counted_dead_end));
+	domain->add_task_methods("dead_end", dead_end_methods);
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	// Keep dead_end from being pruned so that it is refined from the same state twice
+	plan->set_nogood_cache_size(0);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	loc["b"] = "floor";
+	Dictionary initial_state;
+	initial_state["loc"] = loc;
+	Array todo_list = varray(varray("arrange", "x"));
+
+	test_counted_method_calls = 0;
+	Variant impure = plan->find_plan(initial_state, todo_list);
+	CHECK(test_counted_method_calls == 2);
+
+	domain->set_method_pure(callable_mp_static(&test_counted_dead_end), true);
+	CHECK(domain->is_method_pure(callable_mp_static(&test_counted_dead_end)));
+	test_counted_method_calls = 0;
+	Variant pure = plan->find_plan(initial_state, todo_list);
+	CHECK(pure == impure);
+	CHECK(test_counted_method_calls == 1);
+
+	// Results are only reused within one call
+	test_counted_method_calls = 0;
+	plan->find_plan(initial_state, todo_list);
+	CHECK(test_counted_method_calls == 1);
+
+	domain->set_method_pure(callable_mp_static(&test_counted_dead_end), false);
+	CHECK_FALSE(domain->is_method_pure(callable_mp_static(&test_counted_dead_end)));
+}
+
+} // namespace TestMethodMemoization
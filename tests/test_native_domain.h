@@ -0,0 +1,164 @@
+/**************************************************************************/
+/*  test_native_domain.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for native C++ actions and methods in PlannerDomain
+
+#pragma once
+
+#include "../domain.h"
+#include "../plan.h"
+#include "tests/test_macros.h"
+
+namespace TestNativeDomain {
+
+static Variant test_native_move(Dictionary p_state, String p_object, String p_place) {
+	Dictionary new_state = p_state.duplicate();
+	Dictionary new_loc = Dictionary(p_state["loc"]).duplicate();
+	new_loc[p_object] = p_place;
+	new_state["loc"] = new_loc;
+	return new_state;
+}
+
+static Variant test_native_fail(Dictionary p_state, String p_arg) {
+	return Variant();
+}
+
+static Variant test_native_unregistered(Dictionary p_state, String p_arg) {
+	return p_state;
+}
+
+static Variant test_native_a_then_b(Dictionary p_state, String p_arg) {
+	return varray(
+			varray("test_native_move", "a", "table"),
+			varray("test_native_move", "b", "table"),
+			varray("dead_end", p_arg));
+}
+
+static Variant test_native_b_then_a(Dictionary p_state, String p_arg) {
+	return varray(
+			varray("test_native_move", "b", "table"),
+			varray("test_native_move", "a", "table"),
+			varray("dead_end", p_arg));
+}
+
+static Variant test_native_on_shelf(Dictionary p_state, String p_arg) {
+	return varray(varray("test_native_move", "a", "shelf"));
+}
+
+static Variant test_native_dead_end(Dictionary p_state, String p_arg) {
+	return varray(varray("test_native_fail", p_arg));
+}
+
+TEST_CASE("[Modules][NativeDomain] Native actions and methods plan like Callables") {
+	Ref<PlannerDomain> native_domain = memnew(PlannerDomain);
+	native_domain->add_native_action(PLANNER_NATIVE(&test_native_move));
+	native_domain->add_native_action(PLANNER_NATIVE(&test_native_fail));
+	native_domain->add_native_task_method("arrange", PLANNER_NATIVE(&test_native_a_then_b));
+	native_domain->add_native_task_method("arrange", PLANNER_NATIVE(&test_native_b_then_a));
+	native_domain->add_native_task_method("arrange", PLANNER_NATIVE(&test_native_on_shelf));
+	native_domain->add_native_task_method("dead_end", PLANNER_NATIVE(&test_native_dead_end));
+	CHECK(native_domain->get_native_call(callable_mp_static(&test_native_move)) != nullptr);
+	CHECK(native_domain->get_native_call(callable_mp_static(&test_native_unregistered)) == nullptr);
+
+	Ref<PlannerDomain> callable_domain = memnew(PlannerDomain);
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_native_move));
+	actions.push_back(callable_mp_static(&test_native_fail));
+	callable_domain->add_actions(actions);
+	TypedArray<Callable> arrange_methods;
+	arrange_methods.push_back(callable_mp_static(&test_native_a_then_b));
+	arrange_methods.push_back(callable_mp_static(&test_native_b_then_a));
+	arrange_methods.push_back(callable_mp_static(&test_native_on_shelf));
+	callable_domain->add_task_methods("arrange", arrange_methods);
+	TypedArray<Callable> dead_end_methods;
+	dead_end_methods.push_back(callable_mp_static(&test_native_dead_end));
+	callable_domain->add_task_methods("dead_end", dead_end_methods);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	loc["b"] = "floor";
+	Dictionary initial_state;
+	initial_state["loc"] = loc;
+	Array todo_list = varray(varray("arrange", "x"), varray("test_native_move", "b", "table"));
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(callable_domain);
+	Variant expected = plan->find_plan(initial_state, todo_list);
+	REQUIRE(expected.get_type() == Variant::ARRAY);
+
+	plan->set_current_domain(native_domain);
+	CHECK(plan->find_plan(initial_state, todo_list) == expected);
+	CHECK(plan->get_last_expansion_count() > 0);
+
+	// Snapshots used by background planning keep the native entry points
+	Ref<PlannerDomain> snapshot = native_domain->create_snapshot();
+	CHECK(snapshot->get_native_call(callable_mp_static(&test_native_on_shelf)) != nullptr);
+}
+
+static Variant test_native_put_argument;
+
+static Variant test_native_put_method(Dictionary p_state, Variant p_object, Variant p_place) {
+	test_native_put_argument = p_object;
+	return varray(varray("test_native_move", p_object, p_place));
+}
+
+TEST_CASE("[Modules][NativeDomain] Native unigoal methods get the same arguments as Callables") {
+	Ref<PlannerDomain> native_domain = memnew(PlannerDomain);
+	native_domain->add_native_action(PLANNER_NATIVE(&test_native_move));
+	native_domain->add_native_unigoal_method("loc", PLANNER_NATIVE(&test_native_put_method));
+
+	Ref<PlannerDomain> callable_domain = memnew(PlannerDomain);
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_native_move));
+	callable_domain->add_actions(actions);
+	TypedArray<Callable> put_methods;
+	put_methods.push_back(callable_mp_static(&test_native_put_method));
+	callable_domain->add_unigoal_methods("loc", put_methods);
+
+	Dictionary initial_state;
+	initial_state["loc"] = Dictionary();
+	// A non-String argument shows whether the method saw the goal item itself
+	Array todo_list = varray(varray("loc", 7, "table"));
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(callable_domain);
+	test_native_put_argument = Variant();
+	Variant expected = plan->find_plan(initial_state, todo_list);
+	REQUIRE(expected.get_type() == Variant::ARRAY);
+	Variant expected_argument = test_native_put_argument;
+
+	plan->set_current_domain(native_domain);
+	test_native_put_argument = Variant();
+	CHECK(plan->find_plan(initial_state, todo_list) == expected);
+	CHECK(test_native_put_argument.get_type() == expected_argument.get_type());
+	CHECK(test_native_put_argument == expected_argument);
+}
+
+} // namespace TestNativeDomain
@@ -0,0 +1,200 @@
+/**************************************************************************/
+/*  test_nogood_cache.h                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for the per-search nogood cache of PlannerPlan
+
+#pragma once
+
+#include "../domain.h"
+#include "../plan.h"
+#include "tests/test_macros.h"
+
+namespace TestNogoodCache {
+
+static Variant test_nogood_move(Dictionary p_state, String p_object, String p_place) {
+	Dictionary new_state = p_state.duplicate();
+	Dictionary new_loc = Dictionary(p_state["loc"]).duplicate();
+	new_loc[p_object] = p_place;
+	new_state["loc"] = new_loc;
+	return new_state;
+}
+
+static Variant test_nogood_fail(Dictionary p_state, String p_arg) {
+	return Variant();
+}
+
+static Variant test_dead_end_fail(Dictionary p_state, String p_arg) {
+	return varray(varray("test_nogood_fail", p_arg));
+}
+
+static Variant test_dead_end_deep_fail(Dictionary p_state, String p_arg) {
+	return varray(varray("deep_dead_end", p_arg));
+}
+
+static Variant test_arrange_a_then_b(Dictionary p_state, String p_arg) {
+	return varray(
+			varray("test_nogood_move", "a", "table"),
+			varray("test_nogood_move", "b", "table"),
+			varray("dead_end", p_arg));
+}
+
+static Variant test_arrange_b_then_a(Dictionary p_state, String p_arg) {
+	return varray(
+			varray("test_nogood_move", "b", "table"),
+			varray("test_nogood_move", "a", "table"),
+			varray("dead_end", p_arg));
+}
+
+static Variant test_arrange_on_shelf(Dictionary p_state, String p_arg) {
+	return varray(varray("test_nogood_move", "a", "shelf"));
+}
+
+TEST_CASE("[Modules][NogoodCache] Nogood cache prunes repeated failures") {
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_nogood_move));
+	actions.push_back(callable_mp_static(&test_nogood_fail));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> arrange_methods;
+	arrange_methods.push_back(callable_mp_static(&test_arrange_a_then_b));
+	arrange_methods.push_back(callable_mp_static(&test_arrange_b_then_a));
+	arrange_methods.push_back(callable_mp_static(&test_arrange_on_shelf));
+	domain->add_task_methods("arrange", arrange_methods);
+
+	TypedArray<Callable> dead_end_methods;
+	dead_end_methods.push_back(callable_mp_static(&test_dead_end_fail));
+	dead_end_methods.push_back(callable_mp_static(&test_dead_end_deep_fail));
+	domain->add_task_methods("dead_end", dead_end_methods);
+
+	TypedArray<Callable> deep_methods;
+	deep_methods.push_back(callable_mp_static(&test_dead_end_fail));
+	domain->add_task_methods("deep_dead_end", deep_methods);
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	loc["b"] = "floor";
+	Dictionary initial_state;
+	initial_state["loc"] = loc;
+	Array todo_list = varray(varray("arrange", "x"));
+
+	plan->set_nogood_cache_size(0);
+	Variant uncached = plan->find_plan(initial_state, todo_list);
+	int uncached_expansions = plan->get_last_expansion_count();
+	CHECK(plan->get_last_nogood_hit_count() == 0);
+	CHECK(plan->get_last_nogood_miss_count() == 0);
+
+	// Both orderings reach dead_end from the same state, so its second refinement is skipped
+	plan->set_nogood_cache_size(64);
+	Variant cached = plan->find_plan(initial_state, todo_list);
+	CHECK(cached == uncached);
+	CHECK(Array(cached) == varray(varray("test_nogood_move", "a", "shelf")));
+	CHECK(plan->get_last_nogood_hit_count() == 1);
+	CHECK(plan->get_last_nogood_miss_count() > 0);
+	CHECK(plan->get_last_expansion_count() < uncached_expansions);
+
+	// The cache only lives for one call
+	plan->find_plan(initial_state, todo_list);
+	CHECK(plan->get_last_nogood_hit_count() == 1);
+}
+
+static const void *test_doors_seen_by_open = nullptr;
+
+// Replaces the nested dictionary it changes, as PlannerDomain::add_actions() asks
+static Variant test_action_open(Dictionary p_state, String p_door) {
+	test_doors_seen_by_open = Dictionary(p_state["doors"]).id();
+	Dictionary doors = Dictionary(p_state["doors"]).duplicate();
+	doors[p_door] = "open";
+	p_state["doors"] = doors;
+	return p_state;
+}
+
+static Variant test_action_walk(Dictionary p_state, String p_door) {
+	return p_state;
+}
+
+static Variant test_enter_method(Dictionary p_state, String p_door) {
+	if (Dictionary(p_state["doors"])[p_door] != Variant("open")) {
+		return false;
+	}
+	return varray(varray("test_action_walk", p_door));
+}
+
+static Variant test_leave_without_opening(Dictionary p_state, String p_door) {
+	return varray(varray("enter", p_door));
+}
+
+static Variant test_leave_after_opening(Dictionary p_state, String p_door) {
+	return varray(varray("test_action_open", p_door), varray("enter", p_door));
+}
+
+TEST_CASE("[Modules][NogoodCache] Nogood cache sees nested dictionaries that actions replace") {
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_action_open));
+	actions.push_back(callable_mp_static(&test_action_walk));
+	domain->add_actions(actions);
+	TypedArray<Callable> enter_methods;
+	enter_methods.push_back(callable_mp_static(&test_enter_method));
+	domain->add_task_methods("enter", enter_methods);
+	TypedArray<Callable> leave_methods;
+	leave_methods.push_back(callable_mp_static(&test_leave_without_opening));
+	leave_methods.push_back(callable_mp_static(&test_leave_after_opening));
+	domain->add_task_methods("leave", leave_methods);
+
+	Dictionary doors;
+	doors["front"] = "closed";
+	Dictionary initial_state;
+	initial_state["doors"] = doors;
+	Array todo_list = varray(varray("leave", "front"));
+
+	// enter fails with the door closed and is recorded; after the door opens it sits
+	// at the same depth again and must not be mistaken for that failure
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	plan->set_nogood_cache_size(64);
+	Variant result = plan->find_plan(initial_state, todo_list);
+	REQUIRE(result.get_type() == Variant::ARRAY);
+	CHECK(Array(result) == varray(varray("test_action_open", "front"), varray("test_action_walk", "front")));
+	CHECK(plan->get_last_nogood_hit_count() == 0);
+	CHECK(doors["front"] == Variant("closed"));
+	// Actions get the nested dictionaries themselves, not a deep copy
+	CHECK(test_doors_seen_by_open == doors.id());
+
+	plan->set_use_state_trail(true);
+	CHECK(plan->find_plan(initial_state, todo_list) == result);
+	CHECK(doors["front"] == Variant("closed"));
+}
+
+} // namespace TestNogoodCache
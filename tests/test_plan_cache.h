@@ -0,0 +1,144 @@
+/**************************************************************************/
+/*  test_plan_cache.h                                                     */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for the cross-call plan cache of PlannerPlan
+
+#pragma once
+
+#include "../domain.h"
+#include "../plan.h"
+#include "tests/test_macros.h"
+
+namespace TestPlanCache {
+
+static Variant test_cache_move(Dictionary p_state, String p_object, String p_place) {
+	Dictionary new_state = p_state.duplicate();
+	Dictionary new_loc = Dictionary(p_state["loc"]).duplicate();
+	new_loc[p_object] = p_place;
+	new_state["loc"] = new_loc;
+	return new_state;
+}
+
+static Variant test_cache_fail(Dictionary p_state, String p_object, String p_place) {
+	return false;
+}
+
+static Variant test_cache_arrange(Dictionary p_state, String p_object) {
+	return varray(varray("test_cache_move", p_object, "shelf"));
+}
+
+static Ref<PlannerDomain> create_cache_domain() {
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&test_cache_move));
+	domain->add_actions(actions);
+	TypedArray<Callable> arrange_methods;
+	arrange_methods.push_back(callable_mp_static(&test_cache_arrange));
+	domain->add_task_methods("arrange", arrange_methods);
+	return domain;
+}
+
+TEST_CASE("[Modules][PlanCache] Repeated requests return the cached plan") {
+	Ref<PlannerDomain> domain = create_cache_domain();
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	plan->set_plan_cache_size(8);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	Dictionary initial_state;
+	initial_state["loc"] = loc;
+	Array todo_list = varray(varray("arrange", "a"));
+
+	Variant planned = plan->find_plan(initial_state, todo_list);
+	REQUIRE(planned.get_type() == Variant::ARRAY);
+	CHECK(plan->get_last_expansion_count() > 0);
+	CHECK(plan->get_plan_cache_miss_count() == 1);
+
+	// An equal state in new dictionaries hits without searching or running any action
+	Variant cached = plan->find_plan(initial_state.duplicate(true), todo_list.duplicate(true));
+	CHECK(cached == planned);
+	CHECK(plan->get_plan_cache_hit_count() == 1);
+	CHECK(plan->get_last_expansion_count() == 0);
+	CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+
+	// A different state is planned again
+	Dictionary other_state = initial_state.duplicate(true);
+	other_state["turn"] = 2;
+	CHECK(plan->find_plan(other_state, todo_list) == planned);
+	CHECK(plan->get_plan_cache_miss_count() == 2);
+
+	// Search settings are part of the key, so a tighter depth limit is planned again
+	int max_depth = plan->get_max_depth();
+	plan->set_max_depth(1);
+	CHECK(plan->find_plan(initial_state, todo_list) == Variant(false));
+	CHECK(plan->get_plan_cache_miss_count() == 3);
+	plan->set_max_depth(max_depth);
+	CHECK(plan->find_plan(initial_state, todo_list) == planned);
+	CHECK(plan->get_plan_cache_hit_count() == 2);
+
+	plan->clear_plan_cache();
+	CHECK(plan->get_plan_cache_hit_count() == 0);
+	CHECK(plan->get_plan_cache_miss_count() == 0);
+}
+
+TEST_CASE("[Modules][PlanCache] Edited states and domains are planned again") {
+	Ref<PlannerDomain> domain = create_cache_domain();
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	plan->set_plan_cache_size(8);
+
+	Dictionary loc;
+	loc["a"] = "floor";
+	Dictionary state;
+	state["loc"] = loc;
+	Array todo_list = varray(varray("arrange", "a"));
+	Variant planned = plan->find_plan(state, todo_list);
+	REQUIRE(planned.get_type() == Variant::ARRAY);
+
+	// The caller edits its nested dictionary in place between calls
+	loc["a"] = "shelf";
+	plan->find_plan(state, todo_list);
+	CHECK(plan->get_plan_cache_hit_count() == 0);
+	CHECK(plan->get_plan_cache_miss_count() == 2);
+	CHECK(plan->get_last_expansion_count() > 0);
+
+	// Editing the domain in place needs clear_plan_cache(); assigning a new one clears it
+	domain->action_dictionary["test_cache_move"] = callable_mp_static(&test_cache_fail);
+	plan->clear_plan_cache();
+	CHECK(plan->find_plan(state, todo_list) == Variant(false));
+	CHECK(plan->get_plan_cache_miss_count() == 1);
+	plan->set_current_domain(create_cache_domain());
+	CHECK(plan->find_plan(state, todo_list).get_type() == Variant::ARRAY);
+	CHECK(plan->get_plan_cache_miss_count() == 2);
+	CHECK(plan->get_plan_cache_hit_count() == 0);
+}
+
+} // namespace TestPlanCache
@@ -0,0 +1,143 @@
+/**************************************************************************/
+/*  test_planner_flat_state.h                                             */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for the interned flat state representation
+
+#pragma once
+
+#include "../multigoal.h"
+#include "../planner_flat_state.h"
+#include "../planner_state.h"
+#include "tests/test_macros.h"
+
+namespace TestPlannerFlatState {
+
+static Dictionary create_blocks_state() {
+	Dictionary loc;
+	loc["a"] = "table";
+	loc["b"] = "a";
+	Dictionary clear;
+	clear["a"] = false;
+	clear["b"] = true;
+	Dictionary weight;
+	weight["a"] = 1.5;
+	Dictionary path;
+	path["a"] = varray(1, 2);
+
+	Dictionary state;
+	state["loc"] = loc;
+	state["clear"] = clear;
+	state["weight"] = weight;
+	state["path"] = path;
+	state["holding"] = Dictionary();
+	state["turn"] = 3;
+	return state;
+}
+
+TEST_CASE("[Modules][PlannerFlatState] Dictionary round trip") {
+	PlannerStateLayout layout;
+	Dictionary state = create_blocks_state();
+	PlannerFlatState flat = PlannerFlatState::from_dictionary(&layout, state);
+
+	int loc_a = layout.find_slot(layout.find_predicate("loc"), layout.find_argument("a"));
+	REQUIRE(loc_a >= 0);
+	CHECK(flat.get_slot_type(loc_a) == PlannerFlatState::SLOT_STRING);
+	CHECK(layout.get_string(flat.get_string_id(loc_a)) == "table");
+	int turn = layout.find_slot(layout.find_predicate("turn"), PlannerStateLayout::NO_ARGUMENT);
+	CHECK(flat.get_int(turn) == 3);
+
+	CHECK(flat.to_dictionary() == state);
+
+	// A second state on the same layout reuses the interned ids
+	int slot_count = layout.get_slot_count();
+	PlannerFlatState other = PlannerFlatState::from_dictionary(&layout, state);
+	CHECK(layout.get_slot_count() == slot_count);
+	CHECK(other.to_dictionary() == state);
+}
+
+TEST_CASE("[Modules][PlannerFlatState] Goal checks match the Dictionary planner") {
+	PlannerStateLayout layout;
+	Dictionary state = create_blocks_state();
+	PlannerFlatState flat = PlannerFlatState::from_dictionary(&layout, state);
+
+	CHECK(flat.is_goal_achieved(PlannerFlatState::compile_goal(&layout, "loc", "a", "table")));
+	CHECK_FALSE(flat.is_goal_achieved(PlannerFlatState::compile_goal(&layout, "loc", "b", "table")));
+	CHECK_FALSE(flat.is_goal_achieved(PlannerFlatState::compile_goal(&layout, "loc", "c", "table")));
+	CHECK(flat.is_goal_achieved(PlannerFlatState::compile_goal(&layout, "weight", "a", 1.5)));
+	CHECK(flat.is_goal_achieved(PlannerFlatState::compile_goal(&layout, "path", "a", varray(1, 2))));
+
+	Dictionary goal_loc;
+	goal_loc["a"] = "table";
+	goal_loc["b"] = "table";
+	Dictionary goal_clear;
+	goal_clear["b"] = true;
+	Dictionary multigoal;
+	multigoal["loc"] = goal_loc;
+	multigoal["clear"] = goal_clear;
+
+	LocalVector<PlannerFlatState::Goal> goals = PlannerFlatState::compile_multigoal(&layout, multigoal);
+	REQUIRE(goals.size() == 3);
+	LocalVector<int> unmet;
+	flat.get_goals_not_achieved(goals, unmet);
+	Dictionary expected = PlannerMultigoal::method_goals_not_achieved(state, multigoal);
+	CHECK(unmet.size() == 1);
+	CHECK(Dictionary(expected["loc"]).size() == 1);
+	CHECK_FALSE(flat.are_goals_achieved(goals));
+
+	// A typed C++ effect satisfies the remaining goal
+	flat.set_string_id(layout.find_slot(layout.find_predicate("loc"), layout.find_argument("b")), layout.intern_string("table"));
+	CHECK(flat.are_goals_achieved(goals));
+	Dictionary updated_loc = flat.to_dictionary()["loc"];
+	CHECK(updated_loc["b"] == Variant("table"));
+}
+
+TEST_CASE("[Modules][PlannerFlatState] PlannerState conversion") {
+	Ref<PlannerState> planner_state;
+	planner_state.instantiate();
+	planner_state->set_predicate("a", "loc", "table");
+	planner_state->set_predicate("a", "clear", true);
+	planner_state->set_entity_capability("robot", "speed", 2);
+
+	PlannerStateLayout layout;
+	PlannerFlatState flat = PlannerFlatState::from_planner_state(&layout, planner_state);
+	CHECK(flat.is_goal_achieved(PlannerFlatState::compile_goal(&layout, "loc", "a", "table")));
+
+	Dictionary state = flat.to_dictionary();
+	Dictionary capabilities = state["entity_capabilities"];
+	Dictionary robot = capabilities["robot"];
+	CHECK(robot["speed"] == Variant(2));
+
+	Ref<PlannerState> converted = flat.to_planner_state();
+	CHECK(converted->get_predicate("a", "loc") == Variant("table"));
+	CHECK(converted->get_predicate("a", "clear") == Variant(true));
+	CHECK(converted->get_entity_capability("robot", "speed") == Variant(2));
+}
+
+} // namespace TestPlannerFlatState
@@ -0,0 +1,154 @@
+/**************************************************************************/
+/*  test_planner_persistent_state.h                                       */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for the persistent, structurally shared planner state
+
+#pragma once
+
+#include "../planner_persistent_state.h"
+#include "tests/test_macros.h"
+
+namespace TestPlannerPersistentState {
+
+TEST_CASE("[Modules][PlannerPersistentState] Map versions are independent") {
+	PlannerPersistentMap<Variant> empty;
+	PlannerPersistentMap<Variant> map;
+	for (int i = 0; i < 2000; i++) {
+		map = map.with(i, i * 2);
+	}
+	CHECK(map.size() == 2000);
+	CHECK(empty.is_empty());
+
+	PlannerPersistentMap<Variant> changed = map.with(7, "seven").without(1000);
+	CHECK(changed.size() == 1999);
+	CHECK(*changed.getptr(7) == Variant("seven"));
+	CHECK_FALSE(changed.has(1000));
+
+	// The previous version is untouched
+	CHECK(*map.getptr(7) == Variant(14));
+	CHECK(*map.getptr(1000) == Variant(2000));
+
+	int visited = 0;
+	changed.for_each([&visited](const Variant &p_key, const Variant &p_value) {
+		visited++;
+	});
+	CHECK(visited == 1999);
+
+	// String and StringName keys are the same key, as in Dictionary
+	PlannerPersistentMap<Variant> names = empty.with("loc", 1);
+	CHECK(names.has(StringName("loc")));
+	CHECK(names.without(StringName("loc")).is_empty());
+}
+
+TEST_CASE("[Modules][PlannerPersistentState] Dictionary interop shares untouched variables") {
+	Dictionary loc;
+	loc["a"] = "table";
+	loc["b"] = "floor";
+	Dictionary clear;
+	clear["a"] = true;
+	Dictionary initial;
+	initial["loc"] = loc;
+	initial["clear"] = clear;
+	initial["turn"] = 1;
+
+	PlannerPersistentState state = PlannerPersistentState::from_dictionary(initial);
+	CHECK(state.get_variable_count() == 3);
+	CHECK(*state.get_value("loc", "b") == Variant("floor"));
+
+	Dictionary view = state.to_dictionary();
+	CHECK(view == initial);
+	CHECK(view.is_read_only());
+
+	SUBCASE("Updates return a new version") {
+		PlannerPersistentState moved = state.with_value("loc", "b", "table");
+		CHECK(*moved.get_value("loc", "b") == Variant("table"));
+		CHECK(*state.get_value("loc", "b") == Variant("floor"));
+		CHECK(moved.get_variable_entry("clear")->arguments.is_same(state.get_variable_entry("clear")->arguments));
+		CHECK(moved.without_value("loc", "a").get_value("loc", "a") == nullptr);
+		CHECK_FALSE(moved.without_variable("turn").has_variable("turn"));
+	}
+
+	SUBCASE("Action results are converted back lazily") {
+		// What a scripted action does: copy the state, replace the variables it changes
+		Dictionary result = view.duplicate();
+		Dictionary new_loc = Dictionary(view["loc"]).duplicate();
+		new_loc["b"] = "table";
+		result["loc"] = new_loc;
+		result["turn"] = 2;
+
+		PlannerPersistentState next = state.updated_from(result);
+		CHECK(next.to_dictionary() == result);
+		CHECK(*next.get_value("loc", "b") == Variant("table"));
+		CHECK(next.get_variable("turn") == Variant(2));
+		CHECK(next.get_variable_entry("clear")->arguments.is_same(state.get_variable_entry("clear")->arguments));
+		CHECK(*state.get_value("loc", "b") == Variant("floor"));
+
+		// Removals are picked up too
+		Dictionary smaller = result.duplicate();
+		smaller.erase("turn");
+		PlannerPersistentState without_turn = next.updated_from(smaller);
+		CHECK_FALSE(without_turn.has_variable("turn"));
+		CHECK(without_turn.get_variable_count() == 2);
+	}
+}
+
+TEST_CASE("[Modules][PlannerPersistentState] Node versions share what an action left alone") {
+	Dictionary loc;
+	for (int i = 0; i < 1000; i++) {
+		loc[vformat("block%d", i)] = "table";
+	}
+	Dictionary initial;
+	initial["loc"] = loc;
+	for (int i = 0; i < 1000; i++) {
+		initial[vformat("flag%d", i)] = false;
+	}
+	PlannerPersistentState first = PlannerPersistentState::from_dictionary(initial);
+	int full_size = first.count_nodes_not_shared_with(PlannerPersistentState());
+
+	// The planner applies each change an action made to the previous node's version
+	PlannerPersistentState second = first.with_value("loc", "block7", "floor").with_variable("flag3", true);
+	int added = second.count_nodes_not_shared_with(first);
+	CHECK(added > 0);
+	// One path through the variable trie per change, plus one through loc's arguments
+	CHECK(added <= 9);
+	CHECK(full_size > 20 * added);
+	CHECK(second.get_variable_entry("loc")->arguments.count_nodes_not_shared_with(first.get_variable_entry("loc")->arguments) <= 3);
+
+	// An unchanged version adds nothing, and building a Dictionary does not change that
+	PlannerPersistentState same = second;
+	CHECK(same.count_nodes_not_shared_with(second) == 0);
+	Dictionary built = second.build_dictionary();
+	CHECK_FALSE(built.is_read_only());
+	CHECK(Dictionary(built["loc"])["block7"] == Variant("floor"));
+	CHECK(built["flag3"] == Variant(true));
+	CHECK(second.count_nodes_not_shared_with(first) == added);
+}
+
+} // namespace TestPlannerPersistentState
@@ -0,0 +1,247 @@
+/**************************************************************************/
+/*  test_planner_session.h                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for time-sliced planning with PlannerSession
+
+#pragma once
+
+#include "../domain.h"
+#include "../plan.h"
+#include "../planner_session.h"
+#include "tests/test_macros.h"
+
+namespace TestPlannerSession {
+
+static Variant session_count_action(Dictionary p_state, int p_index) {
+	Dictionary new_state = p_state.duplicate();
+	new_state["count"] = int(new_state["count"]) + 1;
+	new_state["last"] = p_index;
+	return new_state;
+}
+
+static Variant session_count_method(Dictionary p_state, int p_first, int p_count) {
+	Array subtasks;
+	for (int i = 0; i < p_count; i++) {
+		Array action;
+		action.push_back("session_count_action");
+		action.push_back(p_first + i);
+		subtasks.push_back(action);
+	}
+	return subtasks;
+}
+
+static Variant session_defer_method(Dictionary p_state, int p_first, int p_count) {
+	return varray(varray("count_later", p_first, p_count));
+}
+
+static Ref<PlannerPlan> create_session_plan() {
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+
+	TypedArray<Callable> actions;
+	actions.push_back(callable_mp_static(&session_count_action));
+	domain->add_actions(actions);
+
+	TypedArray<Callable> task_methods;
+	task_methods.push_back(callable_mp_static(&session_count_method));
+	domain->add_task_methods("count_to", task_methods);
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	return plan;
+}
+
+static Array create_session_todo_list() {
+	Array todo_list;
+	for (int i = 0; i < 4; i++) {
+		Array task;
+		task.push_back("count_to");
+		task.push_back(i * 10);
+		task.push_back(10);
+		todo_list.push_back(task);
+	}
+	return todo_list;
+}
+
+TEST_CASE("[Modules][PlannerSession] Sliced planning matches find_plan") {
+	Ref<PlannerPlan> plan = create_session_plan();
+	Dictionary initial_state;
+	initial_state["count"] = 0;
+	Array todo_list = create_session_todo_list();
+
+	Variant expected = plan->find_plan(initial_state, todo_list);
+	REQUIRE(expected.get_type() == Variant::ARRAY);
+	int total_expansions = plan->get_last_expansion_count();
+
+	Ref<PlannerSession> session = memnew(PlannerSession);
+	session->set_plan(plan);
+	REQUIRE(session->begin(initial_state, todo_list));
+	CHECK_FALSE(session->is_done());
+
+	// The first slice stops after exactly the requested number of expansions
+	CHECK_FALSE(session->step(5));
+	CHECK(session->get_expansion_count() == 5);
+	CHECK(session->get_status() == PlannerPlan::PLAN_STATUS_NONE);
+	CHECK(session->get_result().get_type() == Variant::NIL);
+
+	int slices = 1;
+	while (!session->step(5)) {
+		slices++;
+	}
+	CHECK(slices > 2);
+	CHECK(session->is_done());
+	CHECK(session->get_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+	CHECK(session->get_expansion_count() == total_expansions);
+	CHECK(session->get_result() == expected);
+	CHECK(int(session->get_state()["count"]) == 40);
+	CHECK(session->get_state_hash() == plan->get_state_hash(session->get_state()));
+	CHECK(session->get_state_hash() != plan->get_state_hash(initial_state));
+
+	// Stepping a finished session is a no-op
+	CHECK(session->step(5));
+	CHECK(session->get_result() == expected);
+}
+
+TEST_CASE("[Modules][PlannerSession] Other searches on the plan between slices") {
+	Ref<PlannerPlan> plan = create_session_plan();
+	Dictionary initial_state;
+	initial_state["count"] = 0;
+	Array todo_list = create_session_todo_list();
+	Variant expected = plan->find_plan(initial_state, todo_list);
+
+	Ref<PlannerSession> session = memnew(PlannerSession);
+	session->set_plan(plan);
+	REQUIRE(session->begin(initial_state, todo_list));
+	CHECK_FALSE(session->step(5));
+
+	// A full search and a second session on the same plan run between slices
+	Array other_todo_list = varray(varray("count_to", 100, 3));
+	Variant other = plan->find_plan(initial_state, other_todo_list);
+	CHECK(Array(other).size() == 3);
+
+	Ref<PlannerSession> other_session = memnew(PlannerSession);
+	other_session->set_plan(plan);
+	REQUIRE(other_session->begin(initial_state, other_todo_list));
+	CHECK_FALSE(session->step(5));
+	while (!other_session->step(2)) {
+	}
+	CHECK(other_session->get_result() == other);
+
+	while (!session->step(5)) {
+	}
+	CHECK(session->get_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+	CHECK(session->get_result() == expected);
+	CHECK(int(session->get_state()["count"]) == 40);
+}
+
+TEST_CASE("[Modules][PlannerSession] Edits between slices do not reach the search") {
+	Ref<PlannerPlan> plan = create_session_plan();
+	Dictionary initial_state;
+	initial_state["count"] = 0;
+	Array todo_list = create_session_todo_list();
+	Variant expected = plan->find_plan(initial_state, todo_list);
+
+	SUBCASE("Editing the returned state") {
+		Ref<PlannerSession> session = memnew(PlannerSession);
+		session->set_plan(plan);
+		REQUIRE(session->begin(initial_state, todo_list));
+		CHECK_FALSE(session->step(5));
+
+		Dictionary state = session->get_state();
+		state["count"] = 1000;
+		CHECK(int(session->get_state()["count"]) != 1000);
+
+		while (!session->step(5)) {
+		}
+		CHECK(session->get_result() == expected);
+		CHECK(int(session->get_state()["count"]) == 40);
+	}
+
+	SUBCASE("Editing the domain") {
+		// The session started without methods for the deferred task, so it fails like find_plan did
+		TypedArray<Callable> defer_methods;
+		defer_methods.push_back(callable_mp_static(&session_defer_method));
+		plan->get_current_domain()->add_task_methods("defer", defer_methods);
+		todo_list.push_back(varray("defer", 100, 3));
+		CHECK(plan->find_plan(initial_state, todo_list) == Variant(false));
+
+		Ref<PlannerSession> session = memnew(PlannerSession);
+		session->set_plan(plan);
+		REQUIRE(session->begin(initial_state, todo_list));
+		CHECK_FALSE(session->step(5));
+
+		TypedArray<Callable> task_methods;
+		task_methods.push_back(callable_mp_static(&session_count_method));
+		plan->get_current_domain()->add_task_methods("count_later", task_methods);
+
+		while (!session->step(5)) {
+		}
+		CHECK(session->get_status() == PlannerPlan::PLAN_STATUS_FAILED);
+		CHECK(plan->find_plan(initial_state, todo_list).get_type() == Variant::ARRAY);
+	}
+}
+
+TEST_CASE("[Modules][PlannerSession] Time-sliced planning completes") {
+	Ref<PlannerPlan> plan = create_session_plan();
+	Dictionary initial_state;
+	initial_state["count"] = 0;
+
+	Ref<PlannerSession> session = memnew(PlannerSession);
+	session->set_plan(plan);
+	REQUIRE(session->begin(initial_state, create_session_todo_list()));
+
+	int slices = 0;
+	while (!session->step(0, 200)) {
+		slices++;
+		REQUIRE(slices < 100000);
+	}
+	CHECK(session->get_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+	Array actions = session->get_result();
+	CHECK(actions.size() == 40);
+}
+
+TEST_CASE("[Modules][PlannerSession] Failure is reported") {
+	Ref<PlannerPlan> plan = create_session_plan();
+	Dictionary initial_state;
+	initial_state["count"] = 0;
+
+	Array todo_list;
+	Array unknown_task;
+	unknown_task.push_back("unknown_task");
+	todo_list.push_back(unknown_task);
+
+	Ref<PlannerSession> session = memnew(PlannerSession);
+	session->set_plan(plan);
+	REQUIRE(session->begin(initial_state, todo_list));
+	CHECK(session->step());
+	CHECK(session->get_status() == PlannerPlan::PLAN_STATUS_FAILED);
+	CHECK(session->get_result() == Variant(false));
+}
+
+} // namespace TestPlannerSession
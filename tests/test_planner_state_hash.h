@@ -0,0 +1,135 @@
+/**************************************************************************/
+/*  test_planner_state_hash.h                                             */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+// C++ unit tests for the incremental state hash and the state diff that drives it
+
+#pragma once
+
+#include "../planner_state_diff.h"
+#include "../planner_state_hash.h"
+#include "tests/test_macros.h"
+
+namespace TestPlannerStateHash {
+
+TEST_CASE("[Modules][PlannerStateHash] State hash updates incrementally") {
+	Dictionary loc;
+	loc["a"] = "floor";
+	loc["b"] = "floor";
+	Dictionary state;
+	state["loc"] = loc;
+	state["turn"] = 1;
+	uint64_t hash = PlannerStateHash::hash_state(state);
+
+	// Key order does not matter
+	Dictionary reordered_loc;
+	reordered_loc["b"] = "floor";
+	reordered_loc["a"] = "floor";
+	Dictionary reordered;
+	reordered["turn"] = 1;
+	reordered["loc"] = reordered_loc;
+	CHECK(PlannerStateHash::hash_state(reordered) == hash);
+
+	// An action copies the variables it changes
+	Dictionary next = state.duplicate();
+	Dictionary next_loc = loc.duplicate();
+	next_loc["a"] = "table";
+	next_loc.erase("b");
+	next_loc["c"] = "shelf";
+	next["loc"] = next_loc;
+	next["turn"] = 2;
+	next["holding"] = Dictionary();
+	uint64_t next_hash = PlannerStateHash::update(hash, state, next);
+	CHECK(next_hash == PlannerStateHash::hash_state(next));
+	CHECK(next_hash != hash);
+
+	// Undoing the change restores the original hash
+	CHECK(PlannerStateHash::update(next_hash, next, state) == hash);
+
+	// Each change is reported once: a, b and c of loc, turn, and holding
+	int change_count = 0;
+	uint64_t walked_hash = hash;
+	planner_for_each_state_change(state, next, [&](const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value) {
+		change_count++;
+		walked_hash ^= PlannerStateHash::change_key(p_variable, p_argument, p_old_value, p_new_value);
+	});
+	CHECK(change_count == 5);
+	CHECK(walked_hash == next_hash);
+
+	// An empty variable is not the same as a missing one
+	Dictionary without_holding = next.duplicate();
+	without_holding.erase("holding");
+	CHECK(PlannerStateHash::hash_state(without_holding) != next_hash);
+}
+
+TEST_CASE("[Modules][PlannerStateHash] The diff skips variables an action left alone") {
+	Dictionary big;
+	for (int i = 0; i < 1000; i++) {
+		big[i] = i;
+	}
+	Dictionary small;
+	small["a"] = "floor";
+	small["b"] = "floor";
+	small["c"] = "floor";
+	Dictionary state;
+	state["big"] = big;
+	state["small"] = small;
+	state["turn"] = 1;
+	uint64_t hash = PlannerStateHash::hash_state(state);
+
+	// The action replaces small and sets turn; big is shared with the old state
+	Dictionary next = state.duplicate();
+	Dictionary next_small = small.duplicate();
+	next_small["a"] = "table";
+	next["small"] = next_small;
+	next["turn"] = 2;
+
+	int change_count = 0;
+	uint64_t next_hash = hash;
+	int arguments_read = planner_for_each_state_change(state, next, [&](const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value) {
+		change_count++;
+		next_hash ^= PlannerStateHash::change_key(p_variable, p_argument, p_old_value, p_new_value);
+	});
+	CHECK(change_count == 2);
+	CHECK(next_hash == PlannerStateHash::hash_state(next));
+	// Only the replaced dictionary's three entries were read, none of big's
+	CHECK(arguments_read == 3);
+
+	// A copy of big with equal contents is read in full and reports nothing
+	Dictionary copied = next.duplicate();
+	copied["big"] = big.duplicate();
+	change_count = 0;
+	arguments_read = planner_for_each_state_change(next, copied, [&](const Variant &p_variable, const Variant *p_argument, const Variant *p_old_value, const Variant *p_new_value) {
+		change_count++;
+	});
+	CHECK(change_count == 0);
+	CHECK(arguments_read == 1000);
+}
+
+} // namespace TestPlannerStateHash
@@ -103,6 +103,16 @@ TEST_CASE("[Modules][STN] PlannerSTNSolver basic functionality") {
 		CHECK(removed);
 		CHECK(!stn.has_constraint("a", "b"));
 	}
+
+	SUBCASE("Queries on unknown time points") {
+		stn.add_constraint("a", "b", 10LL, 20LL);
+
+		CHECK(!stn.has_constraint("a", "missing"));
+		CHECK(stn.get_constraint("missing", "b").max_distance == INT64_MAX);
+		CHECK(!stn.remove_constraint("missing", "a"));
+		CHECK(stn.get_time_points().size() == 2);
+		CHECK(stn.has_constraint("b", "a")); // Reverse edge is stored too
+	}
 }
 
 TEST_CASE("[Modules][STN] PlannerSTNSolver consistency checking") {
@@ -211,6 +221,23 @@ TEST_CASE("[Modules][STN] PlannerSTNConstraints interval conversion") {
 		CHECK(constraint.max_distance == absolute_time);
 	}
 
+	SUBCASE("Anchoring the origin to itself adds no self edge") {
+		// The planner anchors the origin to the plan start; as a self edge that was a
+		// negative cycle, so the first full check rejected every temporal plan
+		stn.add_time_point("origin");
+		int64_t absolute_time = 1735689600000000LL;
+
+		CHECK(PlannerSTNConstraints::anchor_to_origin(stn, "origin", absolute_time));
+		CHECK_FALSE(stn.has_constraint("origin", "origin"));
+		stn.check_consistency();
+		CHECK(stn.is_consistent());
+		CHECK(stn.get_distance("origin", "origin") == 0);
+
+		CHECK(PlannerSTNConstraints::add_interval(stn, "action1", 1000000LL, 2000000LL, 1000000LL));
+		stn.check_consistency();
+		CHECK(stn.is_consistent());
+	}
+
 	SUBCASE("Temporal relation: before") {
 		PlannerSTNConstraints::add_durative_action(stn, "action1", 1000000LL);
 		PlannerSTNConstraints::add_durative_action(stn, "action2", 1000000LL);
@@ -303,6 +330,27 @@ TEST_CASE("[Modules][STN] PlannerSTNSolver snapshot and restore") {
 		CHECK(!stn.has_time_point("b"));
 		CHECK(!stn.has_time_point("c"));
 	}
+
+	SUBCASE("Restore into another solver") {
+		stn.add_constraint("a", "b", 10LL, 20LL);
+		stn.add_constraint("b", "c", 5LL, 15LL);
+		PlannerSTNSolver::Snapshot snapshot = stn.create_snapshot();
+
+		PlannerSTNSolver other;
+		other.add_constraint("x", "y", 1LL, 2LL);
+		other.restore_snapshot(snapshot);
+
+		CHECK(!other.has_time_point("x"));
+		CHECK(other.get_time_points() == stn.get_time_points());
+		CHECK(other.get_constraint("b", "c").max_distance == 15LL);
+		CHECK(other.get_distance("a", "c") == 35LL);
+		CHECK(other.create_snapshot().to_dictionary() == snapshot.to_dictionary());
+
+		// Points added after the restore extend the restored matrix
+		other.add_constraint("c", "d", 1LL, 1LL);
+		CHECK(other.get_distance("a", "d") == 36LL);
+		CHECK(stn.create_snapshot().to_dictionary() == snapshot.to_dictionary());
+	}
 }
 
 TEST_CASE("[Modules][STN] Complex temporal scenarios") {
@@ -391,6 +439,228 @@ TEST_CASE("[Modules][STN] Complex temporal scenarios") {
 	}
 }
 
+TEST_CASE("[Modules][STN] Incremental propagation matches Floyd-Warshall") {
+	PlannerSTNSolver incremental;
+	PlannerSTNSolver rebuilt;
+
+	// A chain of actions with overlapping windows, added one constraint at a time
+	const int action_count = 12;
+	for (int i = 0; i < action_count; i++) {
+		String start = "a" + itos(i) + "_start";
+		String end = "a" + itos(i) + "_end";
+		int64_t duration = 5 + (i * 7) % 11;
+		incremental.add_constraint(start, end, duration, duration + 3);
+		rebuilt.add_constraint(start, end, duration, duration + 3);
+		if (i > 0) {
+			String previous_end = "a" + itos(i - 1) + "_end";
+			incremental.add_constraint(previous_end, start, 0, 20);
+			rebuilt.add_constraint(previous_end, start, 0, 20);
+		}
+	}
+	incremental.add_constraint("a0_start", "a11_end", 0, 250);
+	rebuilt.add_constraint("a0_start", "a11_end", 0, 250);
+	CHECK(incremental.is_consistent());
+
+	// Removing a constraint recomputes every distance from scratch
+	rebuilt.add_constraint("a3_end", "a9_start", 0, INT64_MAX);
+	rebuilt.remove_constraint("a3_end", "a9_start");
+
+	Array points = incremental.get_time_points();
+	for (int i = 0; i < points.size(); i++) {
+		for (int j = 0; j < points.size(); j++) {
+			CHECK(incremental.get_distance(points[i], points[j]) == rebuilt.get_distance(points[i], points[j]));
+		}
+	}
+
+	// Tightening the overall window below the chain's minimum makes it inconsistent
+	CHECK_FALSE(incremental.add_constraint("a0_start", "a11_end", 0, 50));
+	CHECK_FALSE(incremental.is_consistent());
+}
+
+// Plain scalar Floyd-Warshall over a dense n x n matrix. It saturates sums the
+// same way the solver does but shares none of its row code, so the vectorised
+// relaxation and the padded matrix layout are checked against it.
+static void reference_floyd_warshall(LocalVector<int64_t> &r_matrix, int p_size) {
+	const int64_t inf = INT64_MAX;
+	const int64_t neg_inf = INT64_MIN + 1;
+	for (int k = 0; k < p_size; k++) {
+		for (int i = 0; i < p_size; i++) {
+			int64_t dist_ik = r_matrix[i * p_size + k];
+			if (dist_ik == inf) {
+				continue;
+			}
+			for (int j = 0; j < p_size; j++) {
+				int64_t dist_kj = r_matrix[k * p_size + j];
+				if (dist_kj == inf) {
+					continue;
+				}
+				int64_t sum;
+				if (dist_ik > 0 && dist_kj > inf - dist_ik) {
+					sum = inf;
+				} else if (dist_ik < 0 && dist_kj < neg_inf - dist_ik) {
+					sum = neg_inf;
+				} else {
+					sum = dist_ik + dist_kj;
+				}
+				if (sum < r_matrix[i * p_size + j]) {
+					r_matrix[i * p_size + j] = sum;
+				}
+			}
+		}
+	}
+}
+
+static bool reference_is_consistent(const LocalVector<int64_t> &p_matrix, int p_size) {
+	for (int i = 0; i < p_size; i++) {
+		if (p_matrix[i * p_size + i] < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static uint64_t reference_random(uint64_t &r_seed) {
+	r_seed = r_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return r_seed >> 11;
+}
+
+TEST_CASE("[Modules][STN] Distances match a reference Floyd-Warshall") {
+	SUBCASE("Random networks") {
+		// 13 points leaves padding at the end of every matrix row
+		const int point_count = 13;
+		uint64_t seed = 12345;
+		for (int network = 0; network < 60; network++) {
+			// Small windows, windows large enough to saturate sums, and unconstrained
+			// weights that mostly end up with negative cycles
+			int mode = network % 3;
+			PlannerSTNSolver stn;
+			for (int i = 0; i < point_count; i++) {
+				stn.add_time_point("p" + itos(i));
+			}
+			LocalVector<int64_t> weights;
+			weights.resize(point_count * point_count);
+			for (int i = 0; i < point_count; i++) {
+				for (int j = 0; j < point_count; j++) {
+					weights[i * point_count + j] = i == j ? 0 : INT64_MAX;
+				}
+			}
+
+			int64_t scale = mode == 0 ? 1000 : (int64_t(1) << 61);
+			LocalVector<int64_t> times;
+			for (int i = 0; i < point_count; i++) {
+				times.push_back(int64_t(reference_random(seed) % uint64_t(scale)) - scale / 2);
+			}
+			int last_from = -1;
+			int last_to = -1;
+			for (int from = 0; from < point_count; from++) {
+				for (int to = from + 1; to < point_count; to++) {
+					if (reference_random(seed) % 3 != 0) {
+						continue;
+					}
+					int64_t min_distance;
+					int64_t max_distance;
+					if (mode == 2) {
+						min_distance = int64_t(reference_random(seed) % 2000) - 1000;
+						max_distance = min_distance + int64_t(reference_random(seed) % 50);
+					} else {
+						// Loose windows around fixed times keep the network consistent
+						int64_t gap = times[to] - times[from];
+						min_distance = gap - int64_t(reference_random(seed) % uint64_t(scale));
+						max_distance = reference_random(seed) % 4 == 0 ? INT64_MAX : gap + int64_t(reference_random(seed) % uint64_t(scale));
+					}
+					stn.add_constraint("p" + itos(from), "p" + itos(to), min_distance, max_distance);
+					weights[from * point_count + to] = max_distance;
+					weights[to * point_count + from] = -min_distance;
+					last_from = from;
+					last_to = to;
+				}
+			}
+			REQUIRE(last_from >= 0);
+
+			LocalVector<int64_t> expected = weights;
+			reference_floyd_warshall(expected, point_count);
+			bool expected_consistent = reference_is_consistent(expected, point_count);
+			CHECK(stn.is_consistent() == expected_consistent);
+			if (mode != 2) {
+				CHECK(expected_consistent);
+			}
+			if (expected_consistent) {
+				// Incremental propagation and a full pass over the closed matrix agree with the reference
+				for (int pass = 0; pass < 2; pass++) {
+					for (int i = 0; i < point_count; i++) {
+						for (int j = 0; j < point_count; j++) {
+							CHECK(stn.get_distance("p" + itos(i), "p" + itos(j)) == expected[i * point_count + j]);
+						}
+					}
+					stn.check_consistency();
+					CHECK(stn.is_consistent());
+				}
+			}
+
+			// Removing an edge recomputes from scratch, so even saturated negative
+			// cycles must come out cell for cell the same
+			stn.remove_constraint("p" + itos(last_from), "p" + itos(last_to));
+			weights[last_from * point_count + last_to] = INT64_MAX;
+			weights[last_to * point_count + last_from] = INT64_MAX;
+			expected = weights;
+			reference_floyd_warshall(expected, point_count);
+			CHECK(stn.is_consistent() == reference_is_consistent(expected, point_count));
+			for (int i = 0; i < point_count; i++) {
+				for (int j = 0; j < point_count; j++) {
+					CHECK(stn.get_distance("p" + itos(i), "p" + itos(j)) == expected[i * point_count + j]);
+				}
+			}
+		}
+	}
+
+	SUBCASE("Saturating sums") {
+		PlannerSTNSolver stn;
+		const int64_t big = int64_t(1) << 62;
+		stn.add_constraint("a", "b", 0, big);
+		stn.add_constraint("b", "c", 0, big);
+		CHECK(stn.get_distance("a", "c") == INT64_MAX); // Overflows, so it reads as unbounded
+		CHECK(stn.get_distance("c", "a") == 0);
+		stn.add_constraint("c", "d", -big, -big);
+		stn.add_constraint("d", "e", -big, -big);
+		CHECK(stn.get_distance("c", "e") == INT64_MIN + 1);
+		CHECK(stn.is_consistent());
+	}
+}
+
+TEST_CASE("[Modules][STN] Undo levels restore earlier networks") {
+	PlannerSTNSolver stn;
+	stn.add_constraint("origin", "a_start", 0LL, 100LL);
+	Dictionary base = stn.create_snapshot().to_dictionary();
+
+	// Enough points to reallocate the matrix inside the level
+	stn.push_level();
+	for (int i = 0; i < 10; i++) {
+		stn.add_constraint("p" + itos(i), "p" + itos(i + 1), 1LL, 5LL);
+	}
+	stn.add_constraint("a_start", "p0", 0LL, 10LL);
+	Dictionary chained = stn.create_snapshot().to_dictionary();
+	CHECK(stn.get_distance("origin", "p10") == 160LL);
+
+	stn.push_level();
+	stn.remove_constraint("origin", "a_start");
+	CHECK_FALSE(stn.add_constraint("a_start", "p10", 0LL, 5LL)); // The chain takes at least 10
+	stn.check_consistency();
+	CHECK_FALSE(stn.is_consistent());
+
+	stn.pop_level();
+	CHECK(stn.is_consistent());
+	CHECK(stn.create_snapshot().to_dictionary() == chained);
+
+	stn.pop_level();
+	CHECK(stn.get_level_count() == 0);
+	CHECK(!stn.has_time_point("p0"));
+	CHECK(stn.create_snapshot().to_dictionary() == base);
+
+	// Points added after undoing extend the restored matrix
+	stn.add_constraint("a_start", "b", 1LL, 2LL);
+	CHECK(stn.get_distance("origin", "b") == 102LL);
+}
+
 TEST_CASE("[Modules][STN] Clear and reset") {
 	PlannerSTNSolver stn;
 
@@ -195,4 +195,44 @@ TEST_CASE("[Modules][Temporal] Temporal constraints validation") {
 	}
 }
 
+static Variant tick_action(Dictionary p_state, int p_index) {
+	p_state["ticks"] = int(p_state["ticks"]) + 1;
+	return p_state;
+}
+
+TEST_CASE("[Modules][Temporal] Many temporal actions in one plan") {
+	// Every action adds two time points; a full Floyd-Warshall pass per action
+	// would make this plan cubic in its length and blow the time budget.
+	const int action_count = 200;
+	Ref<PlannerDomain> domain = memnew(PlannerDomain);
+	Array todo_list;
+	for (int i = 0; i < action_count; i++) {
+		String action_name = vformat("tick_%d", i);
+		domain->action_dictionary[action_name] = callable_mp_static(&tick_action);
+
+		// Anchored to the origin, so every time point reaches every other one
+		int64_t start_time = 1000000LL + i * 2000LL;
+		Dictionary constraints;
+		constraints["start_time"] = start_time;
+		constraints["end_time"] = start_time + 1000LL;
+		constraints["duration"] = 1000LL;
+		Dictionary item;
+		item["item"] = varray(action_name, i);
+		item["constraints"] = constraints;
+		todo_list.push_back(item);
+	}
+
+	Ref<PlannerPlan> plan = memnew(PlannerPlan);
+	plan->set_current_domain(domain);
+	plan->set_verbose(0);
+	plan->set_time_budget_usec(2000000);
+
+	Dictionary state;
+	state["ticks"] = 0;
+	Variant result = plan->find_plan(state, todo_list);
+	CHECK(plan->get_last_plan_status() == PlannerPlan::PLAN_STATUS_SUCCEEDED);
+	REQUIRE(result.get_type() == Variant::ARRAY);
+	CHECK(Array(result).size() == action_count);
+}
+
 } // namespace TestTemporal